@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/pwm.h>
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <ring.h>
+
+#include "audio.h"
+
+/*
+ * Speaker output pin.
+ */
+#if !defined(AUDIO_PIN)
+#define AUDIO_PIN 28
+#endif
+
+/*
+ * Size of the command queue. Must be a power of two.
+ */
+#define AUDIO_QUEUE_SIZE 16
+
+static_assert(0 == (AUDIO_QUEUE_SIZE & (AUDIO_QUEUE_SIZE - 1)),
+	      "AUDIO_QUEUE_SIZE must be a power of two");
+
+struct voice {
+	const int8_t *data;
+	int len;
+	int volume;
+};
+
+static struct voice queue[AUDIO_QUEUE_SIZE];
+static struct ring queue_ring;
+
+/* Owned by the mixer. */
+static struct voice voices[AUDIO_CHANNELS];
+
+static uint16_t buffers[2][AUDIO_BLOCK] __attribute__((aligned(4)));
+static int dma_ch[2];
+
+static uint32_t mix_max_us;
+static unsigned queue_full;
+
+bool audio_play(const int8_t *data, int len, int volume)
+{
+	int slot = ring_claim(&queue_ring, AUDIO_QUEUE_SIZE);
+
+	if (slot < 0) {
+		queue_full++;
+		return false;
+	}
+
+	struct voice *voice = &queue[slot];
+	voice->data = data;
+	voice->len = len;
+	voice->volume = volume;
+
+	ring_publish(&queue_ring);
+
+	return true;
+}
+
+static void audio_start_voices(void)
+{
+	int slot;
+
+	while ((slot = ring_peek(&queue_ring, AUDIO_QUEUE_SIZE)) >= 0) {
+		struct voice *cmd = &queue[slot];
+		struct voice *best = &voices[0];
+
+		for (int i = 1; i < AUDIO_CHANNELS; i++)
+			if (voices[i].len < best->len)
+				best = &voices[i];
+
+		*best = *cmd;
+		ring_release(&queue_ring);
+	}
+}
+
+void audio_mix(uint16_t *out, int len)
+{
+	/* Runs in the DMA interrupt, keep the block off its stack. */
+	static int16_t acc[AUDIO_BLOCK];
+
+	if (len > AUDIO_BLOCK)
+		len = AUDIO_BLOCK;
+
+	for (int i = 0; i < len; i++)
+		acc[i] = 0;
+
+	audio_start_voices();
+
+	for (int v = 0; v < AUDIO_CHANNELS; v++) {
+		struct voice *voice = &voices[v];
+		int n = voice->len < len ? voice->len : len;
+
+		for (int i = 0; i < n; i++)
+			acc[i] += (voice->data[i] * voice->volume) >> 8;
+
+		voice->data += n;
+		voice->len -= n;
+	}
+
+	for (int i = 0; i < len; i++) {
+		int s = acc[i];
+
+		if (s > 127)
+			s = 127;
+
+		if (s < -128)
+			s = -128;
+
+		out[i] = s + 128;
+	}
+}
+
+static void audio_irq(void)
+{
+	for (int i = 0; i < 2; i++) {
+		if (!dma_channel_get_irq1_status(dma_ch[i]))
+			continue;
+
+		dma_channel_acknowledge_irq1(dma_ch[i]);
+
+		/* The other channel is playing now, refill this one. */
+		uint32_t started = time_us_32();
+		audio_mix(buffers[i], AUDIO_BLOCK);
+		dma_channel_set_read_addr(dma_ch[i], buffers[i], false);
+
+		uint32_t took = time_us_32() - started;
+
+		if (took > mix_max_us)
+			mix_max_us = took;
+	}
+}
+
+void audio_init(void)
+{
+	gpio_set_function(AUDIO_PIN, GPIO_FUNC_PWM);
+
+	unsigned slice = pwm_gpio_to_slice_num(AUDIO_PIN);
+
+	/* 8-bit PWM wrapping at the sample rate. */
+	pwm_config pc = pwm_get_default_config();
+	pwm_config_set_wrap(&pc, 255);
+	pwm_config_set_clkdiv(&pc, (float)clock_get_hz(clk_sys) / (256.0f * AUDIO_RATE));
+	pwm_init(slice, &pc, true);
+
+	for (int i = 0; i < 2; i++) {
+		dma_ch[i] = dma_claim_unused_channel(true);
+
+		for (int j = 0; j < AUDIO_BLOCK; j++)
+			buffers[i][j] = 128;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		dma_channel_config dc = dma_channel_get_default_config(dma_ch[i]);
+		channel_config_set_transfer_data_size(&dc, DMA_SIZE_16);
+		channel_config_set_read_increment(&dc, true);
+		channel_config_set_write_increment(&dc, false);
+		channel_config_set_dreq(&dc, pwm_get_dreq(slice));
+		channel_config_set_chain_to(&dc, dma_ch[!i]);
+
+		/* Narrow writes are replicated, so this sets both A and B. */
+		dma_channel_configure(dma_ch[i], &dc, &pwm_hw->slice[slice].cc, buffers[i],
+				      AUDIO_BLOCK, false);
+
+		dma_channel_set_irq1_enabled(dma_ch[i], true);
+	}
+
+	irq_add_shared_handler(DMA_IRQ_1, audio_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+	irq_set_enabled(DMA_IRQ_1, true);
+
+	dma_channel_start(dma_ch[0]);
+}
+
+void audio_stats_report_reset(void)
+{
+	printf("audio: mix max %uus per %i samples, %u dropped\n", (unsigned)mix_max_us,
+	       AUDIO_BLOCK, queue_full);
+
+	mix_max_us = 0;
+	queue_full = 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include "crc32.h"
+
+static uint32_t table[256];
+
+static void crc32_init(void)
+{
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t crc = i;
+
+		for (int j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+
+		table[i] = crc;
+	}
+}
+
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len)
+{
+	const uint8_t *bytes = data;
+
+	if (!table[1])
+		crc32_init();
+
+	crc = ~crc;
+
+	while (len--)
+		crc = (crc >> 8) ^ table[(crc ^ *bytes++) & 0xff];
+
+	return ~crc;
+}
@@ -19,6 +19,7 @@
 #include <stdio.h>
 
 #include "dap.h"
+#include "dap_internal.h"
 
 /*
  * Idle cycles make debugging with logic analyzer easier,
@@ -29,15 +30,36 @@
 #endif
 
 /*
- * How many to count to for half of a bit period.
+ * Cost of a single delay loop iteration and the fixed overhead of
+ * toggling a pin, in clk_sys cycles. Used to compute the delay for
+ * a requested SWD frequency.
+ *
+ * These are not measured, they are the least the Cortex-M0+ can do:
+ * a loop iteration needs at least a decrement and a taken branch, half
+ * a bit period at least the SIO store, setting the loop counter up and
+ * testing it. Real code takes longer, so the link runs somewhat slower
+ * than requested, never faster.
+ */
+#if !defined(DAP_LOOP_CYCLES)
+#define DAP_LOOP_CYCLES 3
+#endif
+
+#if !defined(DAP_OVERHEAD_CYCLES)
+#define DAP_OVERHEAD_CYCLES 4
+#endif
+
+/*
+ * Build in hooks to corrupt transfers on purpose, see dap_inject.
  */
-#if !defined(DAP_DELAY_CYCLES)
-#define DAP_DELAY_CYCLES 25
+#if !defined(DAP_FAULT_INJECT)
+#define DAP_FAULT_INJECT 0
 #endif
 
 static int swdio_pin = -1;
 static int swclk_pin = -1;
 
+static int delay_cycles = DAP_DELAY_CYCLES;
+
 enum {
 	DAP_FRAME = 0x81,
 	DAP_APnDP = 0x02,
@@ -48,12 +70,87 @@ enum dap_status {
 	DAP_OK = 1,
 	DAP_WAIT = 2,
 	DAP_FAULT = 4,
-	DAP_ERROR = 7,
+
+	/* Not an ACK, used for data parity mismatch. */
+	DAP_PARITY = 8,
 };
 
+static enum dap_error last_error = DAP_ERR_NONE;
+static unsigned retries;
+
+#if DAP_FAULT_INJECT
+static struct dap_faults odds;
+static struct dap_faults injected;
+static uint32_t inject_seed = 1;
+
+static bool dap_chance(unsigned chance, unsigned *count)
+{
+	if (!chance)
+		return false;
+
+	/* xorshift32, good enough to pick the victims */
+	inject_seed ^= inject_seed << 13;
+	inject_seed ^= inject_seed >> 17;
+	inject_seed ^= inject_seed << 5;
+
+	if ((inject_seed & 0xffff) >= chance)
+		return false;
+
+	(*count)++;
+	return true;
+}
+
+static uint32_t dap_random_bit(void)
+{
+	return 1u << (inject_seed >> 27);
+}
+
+/*
+ * Answer in place of the target without touching the wire.
+ */
+static bool dap_inject_ack(uint8_t req, enum dap_status *status)
+{
+	/* ABORT and DPIDR always answer OK. */
+	if (DAP_DP0 == (req & (DAP_APnDP | DAP_DPc)))
+		return false;
+
+	if (dap_chance(odds.wait, &injected.wait)) {
+		*status = DAP_WAIT;
+		return true;
+	}
+
+	if (dap_chance(odds.fault, &injected.fault)) {
+		*status = DAP_FAULT;
+		return true;
+	}
+
+	return false;
+}
+#endif
+
+static enum dap_error dap_classify(enum dap_status status)
+{
+	switch (status) {
+	case DAP_OK:
+		return DAP_ERR_NONE;
+
+	case DAP_WAIT:
+		return DAP_ERR_WAIT;
+
+	case DAP_FAULT:
+		return DAP_ERR_FAULT;
+
+	case DAP_PARITY:
+		return DAP_ERR_PARITY;
+
+	default:
+		return DAP_ERR_PROTOCOL;
+	}
+}
+
 static void dap_delay(void)
 {
-	for (int i = 0; i < DAP_DELAY_CYCLES; i++)
+	for (int i = 0; i < delay_cycles; i++)
 		asm volatile("");
 }
 
@@ -132,6 +229,26 @@ void dap_init(int swdio, int swclk)
 	gpio_put(swclk_pin, 1);
 }
 
+int dap_delay_for(uint32_t sys_hz, uint32_t swd_hz)
+{
+	if (!swd_hz)
+		return DAP_DELAY_CYCLES;
+
+	/* Round the half period up so that we never exceed swd_hz. */
+	uint32_t half = (sys_hz + 2 * swd_hz - 1) / (2 * swd_hz);
+
+	if (half <= DAP_OVERHEAD_CYCLES)
+		return 0;
+
+	return (half - DAP_OVERHEAD_CYCLES + DAP_LOOP_CYCLES - 1) / DAP_LOOP_CYCLES;
+}
+
+uint32_t dap_set_clock(uint32_t sys_hz, uint32_t swd_hz)
+{
+	delay_cycles = dap_delay_for(sys_hz, swd_hz);
+	return sys_hz / (2 * (DAP_OVERHEAD_CYCLES + DAP_LOOP_CYCLES * delay_cycles));
+}
+
 void dap_disconnect(void)
 {
 	gpio_set_dir(swdio_pin, GPIO_IN);
@@ -188,6 +305,15 @@ static inline uint32_t dap_parity(uint32_t value)
 
 static enum dap_status dap_try_put(uint8_t req, uint32_t value)
 {
+	uint32_t parity = dap_parity(value);
+
+#if DAP_FAULT_INJECT
+	enum dap_status injected_status;
+
+	if (dap_inject_ack(req, &injected_status))
+		return injected_status;
+#endif
+
 	dap_idle(8);
 
 	dap_write(req, 8);
@@ -201,10 +327,18 @@ static enum dap_status dap_try_put(uint8_t req, uint32_t value)
 	if (DAP_OK != status)
 		return status;
 
+#if DAP_FAULT_INJECT
+	/* Target notices and fails the next transfer. */
+	if (dap_chance(odds.parity, &injected.parity))
+		parity ^= 1;
+	else if (dap_chance(odds.noise, &injected.noise))
+		value ^= dap_random_bit();
+#endif
+
 	dap_write(value, 32);
 	dap_idle(1);
 
-	dap_write(dap_parity(value), 1);
+	dap_write(parity, 1);
 	dap_idle(2);
 
 	return status;
@@ -217,13 +351,16 @@ bool dap_set_reg(enum dap_register reg, uint32_t value)
 	for (int i = 0; i < 32; i++) {
 		enum dap_status status = dap_try_put(req, value);
 
-		if (DAP_WAIT == status)
+		if (DAP_WAIT == status) {
+			retries++;
 			continue;
+		}
 
+		last_error = dap_classify(status);
 		return DAP_OK == status;
 	}
 
-	puts("dap: stalled");
+	last_error = DAP_ERR_WAIT;
 	return false;
 }
 
@@ -231,6 +368,13 @@ static enum dap_status dap_try_read(uint8_t req, uint32_t *value)
 {
 	*value = 0xffffffff;
 
+#if DAP_FAULT_INJECT
+	enum dap_status injected_status;
+
+	if (dap_inject_ack(req, &injected_status))
+		return injected_status;
+#endif
+
 	dap_idle(8);
 
 	dap_write(req, 8);
@@ -251,8 +395,15 @@ static enum dap_status dap_try_read(uint8_t req, uint32_t *value)
 	uint32_t parity = dap_read(1);
 	dap_idle(1);
 
+#if DAP_FAULT_INJECT
+	if (dap_chance(odds.parity, &injected.parity))
+		parity ^= 1;
+	else if (dap_chance(odds.noise, &injected.noise))
+		*value ^= dap_random_bit();
+#endif
+
 	if (dap_parity(*value) != parity)
-		status = DAP_ERROR;
+		status = DAP_PARITY;
 
 fail:
 	dap_turn(GPIO_OUT);
@@ -269,16 +420,52 @@ bool dap_get_reg(enum dap_register reg, uint32_t *value)
 	for (int i = 0; i < 32; i++) {
 		enum dap_status status = dap_try_read(req, value);
 
-		if (DAP_WAIT == status)
+		if (DAP_WAIT == status) {
+			retries++;
 			continue;
+		}
 
+		last_error = dap_classify(status);
 		return DAP_OK == status;
 	}
 
-	puts("dap: stalled");
+	last_error = DAP_ERR_WAIT;
 	return false;
 }
 
+enum dap_error dap_last_error(void)
+{
+	return last_error;
+}
+
+unsigned dap_retries_reset(void)
+{
+	unsigned value = retries;
+	retries = 0;
+	return value;
+}
+
+bool dap_inject(const struct dap_faults *faults)
+{
+#if DAP_FAULT_INJECT
+	odds = *faults;
+	return true;
+#else
+	(void)faults;
+	return false;
+#endif
+}
+
+void dap_injected_reset(struct dap_faults *count)
+{
+#if DAP_FAULT_INJECT
+	*count = injected;
+	injected = (struct dap_faults){ 0 };
+#else
+	*count = (struct dap_faults){ 0 };
+#endif
+}
+
 void dap_select_target(uint32_t target)
 {
 	dap_idle(8);
@@ -405,16 +592,38 @@ bool dap_peek(uint32_t addr, uint32_t *value)
 
 bool dap_peek_many(uint32_t addr, uint32_t *values, int len)
 {
+	if (len < 1)
+		return true;
+
 	if (!dap_set_reg(DAP_AP4, addr))
 		return false;
 
+	/* AP reads are posted, the first one only starts the transfer. */
 	if (!dap_get_reg(DAP_APc, values))
 		return false;
 
-	while (len--)
+	while (--len) {
+		addr += 4;
+
+		/* TAR only auto-increments within a 1 KiB block. */
+		if (!(addr & 0x3ff)) {
+			if (!dap_get_reg(DAP_DPc, values++))
+				return false;
+
+			if (!dap_set_reg(DAP_AP4, addr))
+				return false;
+
+			if (!dap_get_reg(DAP_APc, values))
+				return false;
+
+			continue;
+		}
+
 		if (!dap_get_reg(DAP_APc, values++))
 			return false;
+	}
 
+	/* Collect the last posted value. */
 	if (!dap_get_reg(DAP_DPc, values))
 		return false;
 
@@ -437,9 +646,17 @@ bool dap_poke_many(uint32_t addr, const uint32_t *values, int len)
 	if (!dap_set_reg(DAP_AP4, addr))
 		return false;
 
-	while (len--)
+	while (len--) {
 		if (!dap_set_reg(DAP_APc, *values++))
 			return false;
 
+		addr += 4;
+
+		/* TAR only auto-increments within a 1 KiB block. */
+		if (len && !(addr & 0x3ff))
+			if (!dap_set_reg(DAP_AP4, addr))
+				return false;
+	}
+
 	return true;
 }
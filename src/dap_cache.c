@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "dap.h"
+#include "dap_cache.h"
+
+/*
+ * Number of words per line and number of direct-mapped lines.
+ */
+#if !defined(DAP_CACHE_LINE_WORDS)
+#define DAP_CACHE_LINE_WORDS 8
+#endif
+
+#if !defined(DAP_CACHE_LINES)
+#define DAP_CACHE_LINES 16
+#endif
+
+#if !defined(DAP_CACHE_RANGES)
+#define DAP_CACHE_RANGES 8
+#endif
+
+#define LINE_SIZE (DAP_CACHE_LINE_WORDS * 4)
+
+struct line {
+	uint32_t base;
+	uint8_t valid;
+	uint8_t dirty;
+	uint32_t words[DAP_CACHE_LINE_WORDS];
+};
+
+struct range {
+	uint32_t start, end;
+	enum dap_cache_policy policy;
+};
+
+static_assert(DAP_CACHE_LINE_WORDS <= 8, "valid and dirty masks are 8 bits wide");
+
+static struct line lines[DAP_CACHE_LINES];
+static struct range ranges[DAP_CACHE_RANGES];
+static int num_ranges;
+
+static enum dap_cache_policy dap_cache_policy(uint32_t addr)
+{
+	for (int i = num_ranges - 1; i >= 0; i--)
+		if (addr >= ranges[i].start && addr < ranges[i].end)
+			return ranges[i].policy;
+
+	return DAP_CACHE_UNCACHED;
+}
+
+static struct line *dap_cache_line(uint32_t addr)
+{
+	return &lines[(addr / LINE_SIZE) % DAP_CACHE_LINES];
+}
+
+static bool dap_cache_write_line(struct line *line)
+{
+	int i = 0;
+
+	/* Write runs of consecutive dirty words as blocks. */
+	while (line->dirty) {
+		while (!(line->dirty & (1u << i)))
+			i++;
+
+		int start = i;
+		uint32_t run = 0;
+
+		while (i < DAP_CACHE_LINE_WORDS && (line->dirty & (1u << i)))
+			run |= 1u << i++;
+
+		uint32_t addr = line->base + 4 * start;
+
+		/* Keep the words dirty so that a later flush retries them. */
+		if (!dap_poke_many(addr, &line->words[start], i - start)) {
+			puts("dap_cache: write back failed");
+			return false;
+		}
+
+		line->dirty &= ~run;
+	}
+
+	return true;
+}
+
+/*
+ * Make sure the line holds given address, evicting as needed.
+ */
+static bool dap_cache_claim(struct line *line, uint32_t base)
+{
+	if (line->valid && line->base == base)
+		return true;
+
+	if (line->valid && !dap_cache_write_line(line))
+		return false;
+
+	line->base = base;
+	line->valid = 0;
+	line->dirty = 0;
+
+	return true;
+}
+
+static bool dap_cache_fill(struct line *line)
+{
+	uint32_t words[DAP_CACHE_LINE_WORDS];
+
+	if (!dap_peek_many(line->base, words, DAP_CACHE_LINE_WORDS))
+		return false;
+
+	/* Keep words we have modified. */
+	for (int i = 0; i < DAP_CACHE_LINE_WORDS; i++)
+		if (!(line->dirty & (1u << i)))
+			line->words[i] = words[i];
+
+	line->valid = (1u << DAP_CACHE_LINE_WORDS) - 1;
+	return true;
+}
+
+bool dap_cache_range(uint32_t start, uint32_t end, enum dap_cache_policy policy)
+{
+	if (num_ranges >= DAP_CACHE_RANGES)
+		return false;
+
+	/* Drop lines that might now be cached under a different policy. */
+	if (!dap_cache_flush())
+		return false;
+
+	dap_cache_invalidate(start, end);
+
+	ranges[num_ranges].start = start;
+	ranges[num_ranges].end = end;
+	ranges[num_ranges].policy = policy;
+	num_ranges++;
+
+	return true;
+}
+
+bool dap_cache_peek(uint32_t addr, uint32_t *value)
+{
+	if (DAP_CACHE_UNCACHED == dap_cache_policy(addr))
+		return dap_peek(addr, value);
+
+	uint32_t base = addr & ~(LINE_SIZE - 1);
+	int word = (addr - base) / 4;
+	struct line *line = dap_cache_line(addr);
+
+	if (!dap_cache_claim(line, base))
+		return false;
+
+	if (!(line->valid & (1u << word)))
+		if (!dap_cache_fill(line))
+			return false;
+
+	*value = line->words[word];
+	return true;
+}
+
+bool dap_cache_poke(uint32_t addr, uint32_t value)
+{
+	enum dap_cache_policy policy = dap_cache_policy(addr);
+
+	if (DAP_CACHE_UNCACHED == policy)
+		return dap_poke(addr, value);
+
+	uint32_t base = addr & ~(LINE_SIZE - 1);
+	int word = (addr - base) / 4;
+	struct line *line = dap_cache_line(addr);
+
+	if (DAP_CACHE_WRITE_THROUGH == policy) {
+		if (!dap_poke(addr, value))
+			return false;
+
+		/* Do not allocate, only keep an existing line coherent. */
+		if (line->valid && line->base == base)
+			line->words[word] = value;
+
+		return true;
+	}
+
+	if (!dap_cache_claim(line, base))
+		return false;
+
+	line->words[word] = value;
+	line->valid |= 1u << word;
+	line->dirty |= 1u << word;
+
+	return true;
+}
+
+bool dap_cache_flush(void)
+{
+	for (int i = 0; i < DAP_CACHE_LINES; i++)
+		if (!dap_cache_write_line(&lines[i]))
+			return false;
+
+	return true;
+}
+
+void dap_cache_invalidate(uint32_t start, uint32_t end)
+{
+	for (int i = 0; i < DAP_CACHE_LINES; i++) {
+		struct line *line = &lines[i];
+
+		/* Compare the last byte, line end would wrap at the top. */
+		if (line->base + (LINE_SIZE - 1) >= start && line->base < end) {
+			line->valid = 0;
+			line->dirty = 0;
+		}
+	}
+}
+
+void dap_cache_reset(void)
+{
+	memset(lines, 0, sizeof(lines));
+	num_ranges = 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <stdio.h>
+
+#include "dap.h"
+#include "dap_core.h"
+
+#define DHCSR 0xe000edf0u
+#define DCRSR 0xe000edf4u
+#define DCRDR 0xe000edf8u
+
+#define DHCSR_DBGKEY (0xa05fu << 16)
+#define DHCSR_C_DEBUGEN (1u << 0)
+#define DHCSR_C_HALT (1u << 1)
+#define DHCSR_S_REGRDY (1u << 16)
+#define DHCSR_S_HALT (1u << 17)
+
+#define DCRSR_REGWnR (1u << 16)
+
+/*
+ * How many times to check for the core to halt.
+ */
+#if !defined(DAP_CORE_HALT_TRIES)
+#define DAP_CORE_HALT_TRIES 16
+#endif
+
+static bool dap_core_regrdy(void)
+{
+	uint32_t dhcsr;
+
+	if (!dap_peek(DHCSR, &dhcsr))
+		return false;
+
+	if (!(dhcsr & DHCSR_S_REGRDY)) {
+		puts("dap_core: register transfer not ready");
+		return false;
+	}
+
+	return true;
+}
+
+bool dap_core_halt(bool *was_halted)
+{
+	uint32_t dhcsr;
+
+	if (!dap_peek(DHCSR, &dhcsr))
+		return false;
+
+	if (was_halted)
+		*was_halted = dhcsr & DHCSR_S_HALT;
+
+	if (dhcsr & DHCSR_S_HALT)
+		return true;
+
+	if (!dap_poke(DHCSR, DHCSR_DBGKEY | DHCSR_C_DEBUGEN | DHCSR_C_HALT))
+		return false;
+
+	for (int i = 0; i < DAP_CORE_HALT_TRIES; i++) {
+		if (!dap_peek(DHCSR, &dhcsr))
+			return false;
+
+		if (dhcsr & DHCSR_S_HALT)
+			return true;
+	}
+
+	puts("dap_core: failed to halt");
+	return false;
+}
+
+bool dap_core_resume(void)
+{
+	return dap_poke(DHCSR, DHCSR_DBGKEY | DHCSR_C_DEBUGEN);
+}
+
+bool dap_core_read_regs(uint32_t regs[DAP_CORE_NUM_REGS])
+{
+	/*
+	 * Every round selects a register through DCRSR, which moves TAR to
+	 * DCRDR, and issues a posted DCRDR read returning the previous one.
+	 * The transfer finishes within a few cycles, long before the read.
+	 */
+	uint32_t stale;
+
+	for (int i = 0; i < DAP_CORE_NUM_REGS; i++) {
+		if (!dap_set_reg(DAP_AP4, DCRSR))
+			return false;
+
+		if (!dap_set_reg(DAP_APc, i))
+			return false;
+
+		if (!dap_get_reg(DAP_APc, i ? &regs[i - 1] : &stale))
+			return false;
+	}
+
+	/* Collect the last one. */
+	if (!dap_get_reg(DAP_DPc, &regs[DAP_CORE_NUM_REGS - 1]))
+		return false;
+
+	return dap_core_regrdy();
+}
+
+bool dap_core_write_regs(const uint32_t regs[DAP_CORE_NUM_REGS])
+{
+	/*
+	 * Fill DCRDR first and then, for every register, write DCRSR
+	 * and immediately the value for the next one past it.
+	 */
+	if (!dap_poke(DCRDR, regs[0]))
+		return false;
+
+	for (int i = 0; i < DAP_CORE_NUM_REGS; i++) {
+		if (!dap_set_reg(DAP_AP4, DCRSR))
+			return false;
+
+		if (!dap_set_reg(DAP_APc, DCRSR_REGWnR | i))
+			return false;
+
+		if (i + 1 < DAP_CORE_NUM_REGS)
+			if (!dap_set_reg(DAP_APc, regs[i + 1]))
+				return false;
+	}
+
+	return dap_core_regrdy();
+}
+
+bool dap_core_snapshot(uint32_t regs[DAP_CORE_NUM_REGS])
+{
+	bool was_halted;
+
+	if (!dap_core_halt(&was_halted))
+		return false;
+
+	bool ok = dap_core_read_regs(regs);
+
+	if (!was_halted)
+		ok &= dap_core_resume();
+
+	return ok;
+}
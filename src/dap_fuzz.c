@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <task.h>
+
+#include <dap.h>
+#include <dap_fuzz.h>
+#include <link.h>
+
+/*
+ * Scratch window in the target memory, SRAM4 by default.
+ * Every word in it gets overwritten.
+ */
+#if !defined(DAP_FUZZ_BASE)
+#define DAP_FUZZ_BASE 0x20040000
+#endif
+
+#if !defined(DAP_FUZZ_WORDS)
+#define DAP_FUZZ_WORDS 1024
+#endif
+
+/* Longest transfer, long enough to cross a 1 KiB boundary. */
+#define DAP_FUZZ_MAX_LEN 300
+
+/* Marks words around the read buffer that must not be touched. */
+#define DAP_FUZZ_GUARD 0xdeadbeef
+
+/* How long to wait for the link to come back. */
+#define DAP_FUZZ_LINK_TIMEOUT_MS 5000
+
+enum {
+	FUZZ_POKE = 0,
+	FUZZ_POKE_MANY,
+	FUZZ_PEEK,
+	FUZZ_PEEK_MANY,
+	FUZZ_NUM_OPS,
+};
+
+static uint32_t model[DAP_FUZZ_WORDS];
+static uint32_t known[DAP_FUZZ_WORDS / 32];
+static uint32_t buffer[DAP_FUZZ_MAX_LEN + 2];
+
+static uint32_t seed;
+
+static uint32_t fuzz_random(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static void fuzz_store(unsigned i, uint32_t value)
+{
+	model[i] = value;
+	known[i / 32] |= 1u << (i % 32);
+}
+
+static bool fuzz_check(unsigned i, uint32_t value)
+{
+	if (!(known[i / 32] & (1u << (i % 32))))
+		return true;
+
+	if (model[i] == value)
+		return true;
+
+	printf("fuzz: %#010x reads %#010x, expected %#010x\n",
+	       (unsigned)(DAP_FUZZ_BASE + 4 * i), (unsigned)value, (unsigned)model[i]);
+	return false;
+}
+
+static bool fuzz_link_up(void)
+{
+	for (int i = 0; i < DAP_FUZZ_LINK_TIMEOUT_MS; i++) {
+		if (link_up())
+			return true;
+
+		task_sleep_ms(1);
+	}
+
+	puts("fuzz: link down");
+	return false;
+}
+
+static bool fuzz_op(unsigned op, unsigned start, unsigned len, struct dap_fuzz_report *report)
+{
+	uint32_t addr = DAP_FUZZ_BASE + 4 * start;
+	uint32_t *values = buffer + 1;
+	bool ok = false;
+
+	switch (op) {
+	case FUZZ_POKE:
+		values[0] = fuzz_random();
+
+		if ((ok = dap_poke(addr, values[0])))
+			fuzz_store(start, values[0]);
+
+		break;
+
+	case FUZZ_POKE_MANY:
+		for (unsigned i = 0; i < len; i++)
+			values[i] = fuzz_random();
+
+		if ((ok = dap_poke_many(addr, values, len)))
+			for (unsigned i = 0; i < len; i++)
+				fuzz_store(start + i, values[i]);
+
+		break;
+
+	case FUZZ_PEEK:
+		if ((ok = dap_peek(addr, values)))
+			report->mismatches += !fuzz_check(start, values[0]);
+
+		break;
+
+	case FUZZ_PEEK_MANY:
+		buffer[0] = DAP_FUZZ_GUARD;
+
+		for (unsigned i = 0; i <= len; i++)
+			values[i] = DAP_FUZZ_GUARD;
+
+		ok = dap_peek_many(addr, values, len);
+
+		/* Must not write past the requested length, even on failure. */
+		if (DAP_FUZZ_GUARD != buffer[0] || DAP_FUZZ_GUARD != values[len]) {
+			printf("fuzz: peek_many of %u words overran\n", len);
+			report->overruns++;
+		}
+
+		if (ok)
+			for (unsigned i = 0; i < len; i++)
+				report->mismatches += !fuzz_check(start + i, values[i]);
+
+		break;
+	}
+
+	return ok;
+}
+
+bool dap_fuzz(uint32_t fuzz_seed, unsigned rounds, struct dap_fuzz_report *report)
+{
+	memset(report, 0, sizeof(*report));
+	memset(known, 0, sizeof(known));
+
+	/* Zero would make the generator stuck. */
+	seed = fuzz_seed ? fuzz_seed : 1;
+
+	for (unsigned round = 0; round < rounds; round++) {
+		/* Leave some time to the other tasks. */
+		if (0 == round % 64)
+			task_yield();
+
+		unsigned op = fuzz_random() % FUZZ_NUM_OPS;
+		unsigned len = 1;
+
+		if (FUZZ_POKE_MANY == op || FUZZ_PEEK_MANY == op)
+			len = 1 + fuzz_random() % DAP_FUZZ_MAX_LEN;
+
+		unsigned start = fuzz_random() % (DAP_FUZZ_WORDS - len + 1);
+
+		if (!fuzz_link_up())
+			return false;
+
+		report->ops++;
+
+		if (fuzz_op(op, start, len, report))
+			continue;
+
+		report->failed++;
+
+		if (DAP_ERR_NONE == dap_last_error()) {
+			printf("fuzz: op %u failed without an error\n", op);
+			report->silent++;
+		}
+
+		/* Some earlier write might have been lost as well. */
+		memset(known, 0, sizeof(known));
+		link_failed();
+	}
+
+	return !report->mismatches && !report->overruns && !report->silent;
+}
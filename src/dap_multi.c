@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <string.h>
+#include <stdio.h>
+
+#include "dap.h"
+#include "dap_multi.h"
+#include "dap_internal.h"
+
+/*
+ * How many times to retry a request some link keeps answering WAIT to.
+ */
+#define DAP_MULTI_TRIES 32
+
+enum {
+	DAP_FRAME = 0x81,
+	DAP_RnW = 0x04,
+};
+
+enum {
+	ACK_OK = 1,
+	ACK_WAIT = 2,
+};
+
+static int swclk_pin = -1;
+static int swdio_pins[DAP_MULTI_MAX_LINKS];
+static int num_links;
+
+/* GPIO mask of all SWDIO pins. */
+static uint32_t swdio_mask;
+
+static int delay_cycles = DAP_DELAY_CYCLES;
+
+static void dap_multi_delay(void)
+{
+	for (int i = 0; i < delay_cycles; i++)
+		asm volatile("");
+}
+
+static void dap_multi_clock(int ticks)
+{
+	while (ticks--) {
+		gpio_put(swclk_pin, 0);
+		dap_multi_delay();
+
+		gpio_put(swclk_pin, 1);
+		dap_multi_delay();
+	}
+}
+
+static uint32_t dap_multi_pins(uint32_t links)
+{
+	uint32_t mask = 0;
+
+	for (int i = 0; i < num_links; i++)
+		if (links & (1u << i))
+			mask |= 1u << swdio_pins[i];
+
+	return mask;
+}
+
+/*
+ * Send bits to selected links, others see the line idle low.
+ */
+static void dap_multi_write(uint32_t word, int len, uint32_t pins)
+{
+	while (len--) {
+		gpio_put_masked(swdio_mask, (word & 1) ? pins : 0);
+		dap_multi_clock(1);
+		word >>= 1;
+	}
+
+	/* Idle low */
+	gpio_put_masked(swdio_mask, 0);
+}
+
+/*
+ * Sample bits from all links and distribute them by link.
+ *
+ * Pins in release are turned around after the first bit and driven
+ * idle, which is how links that did not ACK sit out a data phase.
+ */
+static void dap_multi_read(int len, uint32_t *values, uint32_t links, uint32_t release)
+{
+	uint32_t samples[32];
+
+	for (int i = 0; i < len; i++) {
+		samples[i] = gpio_get_all();
+		dap_multi_clock(1);
+
+		if (!i && release) {
+			gpio_put_masked(release, 0);
+			gpio_set_dir_masked(release, release);
+		}
+	}
+
+	for (int l = 0; l < num_links; l++) {
+		if (!(links & (1u << l)))
+			continue;
+
+		values[l] = 0;
+
+		for (int i = 0; i < len; i++)
+			values[l] |= ((samples[i] >> swdio_pins[l]) & 1) << i;
+	}
+}
+
+static void dap_multi_turn(int dir, uint32_t pins)
+{
+	if (GPIO_OUT == dir) {
+		dap_multi_clock(1);
+		gpio_set_dir_masked(pins, pins);
+	} else {
+		gpio_set_dir_masked(pins, 0);
+		dap_multi_clock(1);
+	}
+}
+
+static inline uint32_t dap_multi_parity(uint32_t value)
+{
+	return __builtin_popcount(value) & 1;
+}
+
+/*
+ * The delay is computed with the single link overhead. Masked pin
+ * access and sampling all pins cost a few more cycles per bit here,
+ * so the links end up somewhat slower than requested, never faster.
+ */
+void dap_multi_set_clock(uint32_t sys_hz, uint32_t swd_hz)
+{
+	delay_cycles = dap_delay_for(sys_hz, swd_hz);
+}
+
+uint32_t dap_multi_init(int swclk, const int *swdio, int n)
+{
+	if (n > DAP_MULTI_MAX_LINKS)
+		n = DAP_MULTI_MAX_LINKS;
+
+	swclk_pin = swclk;
+	num_links = n;
+	swdio_mask = 0;
+
+	for (int i = 0; i < n; i++) {
+		swdio_pins[i] = swdio[i];
+		swdio_mask |= 1u << swdio[i];
+
+		gpio_init(swdio[i]);
+		gpio_set_pulls(swdio[i], true, false);
+	}
+
+	gpio_init(swclk_pin);
+
+	gpio_set_dir_masked(swdio_mask, swdio_mask);
+	gpio_put_masked(swdio_mask, 0);
+
+	gpio_set_dir(swclk_pin, GPIO_OUT);
+	gpio_put(swclk_pin, 1);
+
+	return (1u << n) - 1;
+}
+
+void dap_multi_reset(void)
+{
+	static const uint32_t sequence[][2] = {
+		/* Line reset */
+		{ 0xffffffff, 32 },
+		{ 0x00ffffff, 32 },
+
+		/* Leave dormant state, see dap_reset. */
+		{ 0xff, 8 },
+		{ 0x6209f392, 32 },
+		{ 0x86852d95, 32 },
+		{ 0xe3ddafe9, 32 },
+		{ 0x19bc0ea2, 32 },
+		{ 0xf1a0, 16 },
+
+		/* Line reset */
+		{ 0xffffffff, 32 },
+		{ 0x00ffffff, 32 },
+	};
+
+	for (unsigned i = 0; i < sizeof(sequence) / sizeof(*sequence); i++)
+		dap_multi_write(sequence[i][0], sequence[i][1], swdio_mask);
+}
+
+void dap_multi_select_target(uint32_t target)
+{
+	uint32_t acks[DAP_MULTI_MAX_LINKS];
+
+	uint32_t req = DAP_DPc | dap_multi_parity(DAP_DPc);
+	dap_multi_write(DAP_FRAME | req, 8, swdio_mask);
+
+	/* Targets do not respond to TARGETSEL. */
+	dap_multi_turn(GPIO_IN, swdio_mask);
+	dap_multi_read(3, acks, 0, 0);
+	dap_multi_turn(GPIO_OUT, swdio_mask);
+
+	dap_multi_write(target, 32, swdio_mask);
+	dap_multi_write(dap_multi_parity(target), 1, swdio_mask);
+}
+
+/*
+ * Send request to selected links and collect their ACKs.
+ *
+ * Leaves all requested lines as inputs, callers turn them around.
+ */
+static uint32_t dap_multi_request(uint8_t req, uint32_t links, uint32_t *wait)
+{
+	uint32_t acks[DAP_MULTI_MAX_LINKS];
+	uint32_t pins = dap_multi_pins(links);
+	uint32_t ok = 0;
+
+	*wait = 0;
+
+	dap_multi_write(req, 8, pins);
+	dap_multi_turn(GPIO_IN, pins);
+	dap_multi_read(3, acks, links, 0);
+
+	for (int l = 0; l < num_links; l++) {
+		if (!(links & (1u << l)))
+			continue;
+
+		if (ACK_OK == acks[l])
+			ok |= 1u << l;
+		else if (ACK_WAIT == acks[l])
+			*wait |= 1u << l;
+	}
+
+	return ok;
+}
+
+static uint32_t dap_multi_try_put(uint8_t req, uint32_t value, uint32_t links, uint32_t *wait)
+{
+	uint32_t ok = dap_multi_request(req, links, wait);
+
+	/* Links that did not ACK just see an idle line from now on. */
+	dap_multi_turn(GPIO_OUT, dap_multi_pins(links));
+
+	if (!ok)
+		return 0;
+
+	uint32_t pins = dap_multi_pins(ok);
+
+	dap_multi_write(value, 32, pins);
+	dap_multi_write(dap_multi_parity(value), 1, pins);
+
+	return ok;
+}
+
+static uint32_t dap_multi_try_read(uint8_t req, uint32_t *values, uint32_t links,
+				   uint32_t *wait)
+{
+	uint32_t ok = dap_multi_request(req, links, wait);
+	uint32_t failed = dap_multi_pins(links & ~ok);
+
+	if (!ok) {
+		dap_multi_turn(GPIO_OUT, failed);
+		return 0;
+	}
+
+	uint32_t parity[DAP_MULTI_MAX_LINKS];
+
+	dap_multi_read(32, values, ok, failed);
+	dap_multi_read(1, parity, ok, 0);
+
+	dap_multi_turn(GPIO_OUT, dap_multi_pins(ok));
+
+	for (int l = 0; l < num_links; l++)
+		if ((ok & (1u << l)) && dap_multi_parity(values[l]) != parity[l])
+			ok &= ~(1u << l);
+
+	return ok;
+}
+
+uint32_t dap_multi_set_reg(enum dap_register reg, uint32_t value, uint32_t links)
+{
+	uint8_t req = DAP_FRAME | reg | (dap_multi_parity(reg) << 5);
+	uint32_t done = 0;
+
+	for (int i = 0; links && i < DAP_MULTI_TRIES; i++) {
+		uint32_t wait;
+
+		done |= dap_multi_try_put(req, value, links, &wait);
+
+		/* Only links that asked us to wait get the request again. */
+		links = wait;
+	}
+
+	return done;
+}
+
+uint32_t dap_multi_get_reg(enum dap_register reg, uint32_t *values, uint32_t links)
+{
+	uint8_t req = DAP_RnW | reg;
+	req |= DAP_FRAME | (dap_multi_parity(req) << 5);
+
+	uint32_t done = 0;
+	uint32_t tmp[DAP_MULTI_MAX_LINKS];
+
+	for (int i = 0; links && i < DAP_MULTI_TRIES; i++) {
+		uint32_t wait;
+		uint32_t ok = dap_multi_try_read(req, tmp, links, &wait);
+
+		for (int l = 0; l < num_links; l++)
+			if (ok & (1u << l))
+				values[l] = tmp[l];
+
+		done |= ok;
+		links = wait;
+	}
+
+	return done;
+}
+
+uint32_t dap_multi_read_idcode(uint32_t links, uint32_t *idcodes)
+{
+	return dap_multi_get_reg(DAP_DP0, idcodes, links);
+}
+
+uint32_t dap_multi_setup_mem(uint32_t links)
+{
+	uint32_t values[DAP_MULTI_MAX_LINKS];
+
+	/* Same sequence as dap_setup_mem, minus reporting the IDR. */
+	links = dap_multi_set_reg(DAP_DP0, 0x1f, links);
+	links = dap_multi_set_reg(DAP_DP8, 0x00, links);
+	links = dap_multi_set_reg(DAP_DP4, 0x51000f00, links);
+	links = dap_multi_get_reg(DAP_DP4, values, links);
+	links = dap_multi_set_reg(DAP_DP8, 0xf0, links);
+	links = dap_multi_get_reg(DAP_APc, values, links);
+	links = dap_multi_get_reg(DAP_DPc, values, links);
+	links = dap_multi_set_reg(DAP_DP8, 0xd00, links);
+	links = dap_multi_set_reg(DAP_AP0, 0x80000052, links);
+	links = dap_multi_set_reg(DAP_DP8, 0, links);
+
+	return links;
+}
+
+uint32_t dap_multi_peek(uint32_t addr, uint32_t *values, uint32_t links)
+{
+	links = dap_multi_set_reg(DAP_AP4, addr, links);
+	links = dap_multi_get_reg(DAP_APc, values, links);
+	links = dap_multi_get_reg(DAP_DPc, values, links);
+
+	return links;
+}
+
+/*
+ * Store a word read from every link into that link's block.
+ */
+static void dap_multi_scatter(uint32_t *values, int len, int i, const uint32_t *words,
+			      uint32_t links)
+{
+	for (int l = 0; l < num_links; l++)
+		if (links & (1u << l))
+			values[l * len + i] = words[l];
+}
+
+uint32_t dap_multi_peek_many(uint32_t addr, uint32_t *values, int len, uint32_t links)
+{
+	uint32_t words[DAP_MULTI_MAX_LINKS];
+
+	if (len < 1)
+		return links;
+
+	links = dap_multi_set_reg(DAP_AP4, addr, links);
+
+	/* AP reads are posted, the first one only starts the transfer. */
+	links = dap_multi_get_reg(DAP_APc, words, links);
+
+	for (int i = 0; links && i < len - 1; i++) {
+		addr += 4;
+
+		/* TAR only auto-increments within a 1 KiB block. */
+		if (!(addr & 0x3ff)) {
+			links = dap_multi_get_reg(DAP_DPc, words, links);
+			dap_multi_scatter(values, len, i, words, links);
+
+			links = dap_multi_set_reg(DAP_AP4, addr, links);
+			links = dap_multi_get_reg(DAP_APc, words, links);
+			continue;
+		}
+
+		links = dap_multi_get_reg(DAP_APc, words, links);
+		dap_multi_scatter(values, len, i, words, links);
+	}
+
+	/* Collect the last posted value. */
+	links = dap_multi_get_reg(DAP_DPc, words, links);
+	dap_multi_scatter(values, len, len - 1, words, links);
+
+	return links;
+}
+
+uint32_t dap_multi_poke(uint32_t addr, uint32_t value, uint32_t links)
+{
+	links = dap_multi_set_reg(DAP_AP4, addr, links);
+	links = dap_multi_set_reg(DAP_APc, value, links);
+
+	return links;
+}
+
+uint32_t dap_multi_poke_many(uint32_t addr, const uint32_t *values, int len, uint32_t links)
+{
+	links = dap_multi_set_reg(DAP_AP4, addr, links);
+
+	while (links && len--) {
+		links = dap_multi_set_reg(DAP_APc, *values++, links);
+		addr += 4;
+
+		/* TAR only auto-increments within a 1 KiB block. */
+		if (len && !(addr & 0x3ff))
+			links = dap_multi_set_reg(DAP_AP4, addr, links);
+	}
+
+	return links;
+}
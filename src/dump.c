@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <string.h>
+#include <stdio.h>
+
+#include <task.h>
+#include <dap.h>
+
+#include "crc32.h"
+#include "dump.h"
+
+/*
+ * Words per frame. One frame never crosses a 1 KiB boundary
+ * when the dump starts aligned.
+ */
+#define DUMP_BLOCK 256
+
+#define DUMP_MAX_RUN 128
+
+static void dump_write(const void *data, int len)
+{
+	const uint8_t *bytes = data;
+
+	/* Bypass CRLF translation. */
+	while (len--)
+		putchar_raw(*bytes++);
+}
+
+static int dump_repeats(const uint32_t *words, int n)
+{
+	int i = 1;
+
+	while (i < n && i < DUMP_MAX_RUN && words[i] == words[0])
+		i++;
+
+	return i;
+}
+
+int dump_compress(const uint32_t *words, int n, uint8_t *out)
+{
+	uint8_t *start = out;
+	int i = 0;
+
+	while (i < n) {
+		int reps = dump_repeats(words + i, n - i);
+
+		if (reps >= 2) {
+			*out++ = 0x80 + reps - 1;
+			memcpy(out, &words[i], 4);
+			out += 4;
+			i += reps;
+			continue;
+		}
+
+		/* Gather literals until a repeat starts. */
+		int lits = 1;
+
+		while (i + lits < n && lits < DUMP_MAX_RUN &&
+		       dump_repeats(words + i + lits, n - i - lits) < 2)
+			lits++;
+
+		*out++ = lits - 1;
+		memcpy(out, &words[i], 4 * lits);
+		out += 4 * lits;
+		i += lits;
+	}
+
+	return out - start;
+}
+
+static void dump_frame(uint32_t addr, int words, const uint8_t *payload, int len)
+{
+	uint8_t header[8];
+
+	memcpy(header + 0, &addr, 4);
+	header[4] = words;
+	header[5] = words >> 8;
+	header[6] = len;
+	header[7] = len >> 8;
+
+	uint32_t crc = crc32_update(0, header, sizeof(header));
+	crc = crc32_update(crc, payload, len);
+
+	dump_write("DUMP", 4);
+	dump_write(header, sizeof(header));
+	dump_write(payload, len);
+	dump_write(&crc, 4);
+}
+
+bool dump_stream(uint32_t addr, uint32_t len)
+{
+	static uint32_t block[DUMP_BLOCK];
+	static uint8_t packed[DUMP_BLOCK * 4 + DUMP_BLOCK / DUMP_MAX_RUN + 1];
+
+	if (len > UINT32_MAX - addr) {
+		puts("dump: range wraps around");
+		return false;
+	}
+
+	uint32_t end = addr + (len & ~3u);
+
+	while (addr < end) {
+		int words = DUMP_BLOCK - (addr & (4 * DUMP_BLOCK - 1)) / 4;
+
+		if (words > (int)(end - addr) / 4)
+			words = (end - addr) / 4;
+
+		if (!dap_peek_many(addr, block, words))
+			break;
+
+		int size = dump_compress(block, words, packed);
+		dump_frame(addr, words, packed, size);
+		addr += 4 * words;
+
+		/*
+		 * Reading, packing and writing run back to back on this core.
+		 * Let input and others run between blocks.
+		 */
+		task_sleep_ms(1);
+	}
+
+	dump_frame((end - addr) / 4, 0, NULL, 0);
+	stdio_flush();
+
+	return addr == end;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <tft.h>
+
+#include <audio.h>
+#include <game.h>
+#include <input.h>
+#include <sounds.h>
+
+static void reset_hamster(struct hamster *h)
+{
+	h->dy = 0;
+	h->y = tft_height - 31;
+	h->px = -1;
+	h->py = -1;
+	h->hp = GAME_MAX_HP;
+}
+
+void game_reset(struct game *game)
+{
+	reset_hamster(&game->p1);
+	reset_hamster(&game->p2);
+}
+
+static void play(bool audible, const int8_t *data, int len, int volume)
+{
+	if (audible)
+		audio_play(data, len, volume);
+}
+
+void game_step(struct game *game, uint32_t buttons, bool audible)
+{
+	struct hamster *p1 = &game->p1;
+	struct hamster *p2 = &game->p2;
+
+	bool p1_up_btn = buttons & (1u << INPUT_P1_UP);
+	bool p1_gun_btn = buttons & (1u << INPUT_P1_GUN);
+	bool p2_up_btn = buttons & (1u << INPUT_P2_UP);
+	bool p2_gun_btn = buttons & (1u << INPUT_P2_GUN);
+
+	float bottom = tft_height - 31;
+
+	/*
+	 * Jumping
+	 */
+
+	if ((p1->y >= tft_height - 31) && p1_up_btn) {
+		p1->dy = -tft_height * 1.15;
+		play(audible, sound_jump, sound_jump_len, 128);
+	}
+
+	if ((p1->px < 0) && p1_gun_btn) {
+		p1->px = 24;
+		p1->py = p1->y + 16;
+		play(audible, sound_shot, sound_shot_len, 160);
+	}
+
+	if ((p2->y >= tft_height - 31) && p2_up_btn) {
+		p2->dy = -tft_height * 1.15;
+		play(audible, sound_jump, sound_jump_len, 128);
+	}
+
+	if ((p2->px < 0) && p2_gun_btn) {
+		p2->px = tft_width - 25;
+		p2->py = p2->y + 16;
+		play(audible, sound_shot, sound_shot_len, 160);
+	}
+
+	/*
+	 * Vertical movement
+	 */
+
+	p1->y += p1->dy / TICK_RATE;
+	p2->y += p2->dy / TICK_RATE;
+
+	/*
+	 * Gravitation
+	 */
+
+	p1->dy += (float)tft_height / TICK_RATE;
+	p2->dy += (float)tft_height / TICK_RATE;
+
+	/*
+	 * Fall boosting
+	 */
+
+	if (p1->dy > 0 && p1_up_btn) {
+		p1->dy += (float)tft_height / TICK_RATE;
+	}
+
+	if (p2->dy > 0 && p2_up_btn) {
+		p2->dy += (float)tft_height / TICK_RATE;
+	}
+
+	/*
+	 * Cap acceleration and keep hamsters above floor
+	 */
+
+	if (p1->dy > tft_height)
+		p1->dy = tft_height;
+
+	if (p2->dy > tft_height)
+		p2->dy = tft_height;
+
+	if (p1->y >= bottom)
+		p1->y = bottom;
+
+	if (p2->y >= bottom)
+		p2->y = bottom;
+
+	/*
+	 * Mid-air projectile collissions
+	 */
+
+	if (p1->px >= 0 && p2->px >= 0) {
+		if ((p1->py <= p2->py + 1) && (p1->py >= p2->py - 1)) {
+			/* Projectiles are at about the same height. */
+
+			if (p1->px >= p2->px) {
+				/* They must have collided. */
+				p1->px = -1;
+				p2->px = -1;
+			}
+		}
+	}
+
+	/*
+	 * Horizontal projectile movement
+	 */
+
+	float pdistance = 0.5 * (float)tft_width / TICK_RATE;
+
+	if (p1->px >= 0)
+		p1->px += pdistance;
+
+	if (p2->px >= 0)
+		p2->px -= pdistance;
+
+	if (p1->px >= tft_width)
+		p1->px = -1;
+
+	if (p2->px < 0)
+		p2->px = -1;
+
+	/*
+	 * Projectile-hamster collissions
+	 */
+
+	if (p1->px >= 0) {
+		if (p1->py >= p2->y && p1->py < (p2->y + 32)) {
+			if (p1->px >= tft_width - 24) {
+				p1->px = -1;
+				p2->hp -= 1;
+				play(audible, sound_hit, sound_hit_len, 256);
+
+				if (p2->hp < 1)
+					game_reset(game);
+			}
+		}
+	}
+
+	if (p2->px >= 0) {
+		if (p2->py >= p1->y && p2->py < (p1->y + 32)) {
+			if (p2->px < 24) {
+				p2->px = -1;
+				p1->hp -= 1;
+				play(audible, sound_hit, sound_hit_len, 256);
+
+				if (p1->hp < 1)
+					game_reset(game);
+			}
+		}
+	}
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Sound effects mixed into blocks that DMA feeds to a PWM slice.
+ *
+ * PWM wraps at the sample rate and paces two chained DMA channels, each
+ * playing one block while the other one is being mixed in its completion
+ * interrupt. The CPU is thus only involved once per block.
+ */
+
+#define AUDIO_RATE 22050
+#define AUDIO_BLOCK 256
+#define AUDIO_CHANNELS 4
+
+/*
+ * Start the output. Mixing runs on the calling core.
+ */
+void audio_init(void);
+
+/*
+ * Queue a signed 8-bit sample to be played on a free channel,
+ * replacing the one closest to finishing when there is none.
+ *
+ * Volume is 0 to 256. Safe to call from a single other core,
+ * the data must stay valid until played.
+ */
+bool audio_play(const int8_t *data, int len, int volume);
+
+/*
+ * Mix the next block of unsigned 8-bit samples.
+ *
+ * Called from the DMA interrupt, does not touch any hardware.
+ */
+void audio_mix(uint16_t *out, int len);
+
+/*
+ * Print and reset mixing cost statistics.
+ */
+void audio_stats_report_reset(void);
@@ -29,6 +29,37 @@ enum dap_register {
 	DAP_APc = 0x18 | 0x02,
 };
 
+enum dap_error {
+	DAP_ERR_NONE = 0,
+
+	/* Target kept responding WAIT. */
+	DAP_ERR_WAIT,
+
+	/* Target responded FAULT, sticky error flags need clearing. */
+	DAP_ERR_FAULT,
+
+	/* Data were corrupted on the wire. */
+	DAP_ERR_PARITY,
+
+	/* No valid response at all, the link is probably lost. */
+	DAP_ERR_PROTOCOL,
+};
+
+/*
+ * Faults to inject into register transfers, when built with DAP_FAULT_INJECT.
+ */
+struct dap_faults {
+	/* Target answers WAIT or FAULT instead of performing the transfer. */
+	unsigned wait;
+	unsigned fault;
+
+	/* Parity bit is flipped on the wire. */
+	unsigned parity;
+
+	/* A data bit is flipped on the wire, parity is left alone. */
+	unsigned noise;
+};
+
 /*
  * Initialize the DAP using following pins.
  *
@@ -40,6 +71,21 @@ enum dap_register {
  */
 void dap_init(int swdio, int swclk);
 
+/*
+ * Compute delay loop count for given clk_sys and SWD frequencies.
+ *
+ * The result never makes the link faster than requested.
+ * Zero swd_hz selects the default delay.
+ */
+int dap_delay_for(uint32_t sys_hz, uint32_t swd_hz);
+
+/*
+ * Adjust the SWD bit period after clk_sys has changed.
+ *
+ * Returns the highest SWD frequency the link may end up running at.
+ */
+uint32_t dap_set_clock(uint32_t sys_hz, uint32_t swd_hz);
+
 /*
  * Reinitialize the communication link.
  */
@@ -81,6 +127,29 @@ bool dap_get_reg(enum dap_register reg, uint32_t *value);
  */
 bool dap_set_reg(enum dap_register reg, uint32_t value);
 
+/*
+ * Return the reason the last register access failed.
+ */
+enum dap_error dap_last_error(void);
+
+/*
+ * Return number of transfers retried after WAIT and reset it.
+ */
+unsigned dap_retries_reset(void);
+
+/*
+ * Set chances of every kind of fault, out of 65536 per transfer.
+ *
+ * ABORT and DPIDR are never answered with WAIT or FAULT, just as by real
+ * targets. Returns false when fault injection has not been built in.
+ */
+bool dap_inject(const struct dap_faults *odds);
+
+/*
+ * Return number of faults injected so far and reset them.
+ */
+void dap_injected_reset(struct dap_faults *count);
+
 /*
  * Read word from target's memory.
  */
@@ -88,6 +157,9 @@ bool dap_peek(uint32_t addr, uint32_t *value);
 
 /*
  * Read multiple consecutive words from target's memory.
+ *
+ * Exactly len words are read from the target and stored.
+ * Transfers may cross 1 KiB boundaries.
  */
 bool dap_peek_many(uint32_t addr, uint32_t *values, int len);
 
@@ -97,6 +169,8 @@ bool dap_peek_many(uint32_t addr, uint32_t *values, int len);
 bool dap_poke(uint32_t addr, uint32_t value);
 
 /*
- * Read multiple consecutive words to target's memory.
+ * Write multiple consecutive words to target's memory.
+ *
+ * Transfers may cross 1 KiB boundaries.
  */
 bool dap_poke_many(uint32_t addr, const uint32_t *values, int len);
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Small cache of the target memory in front of dap_peek and dap_poke.
+ *
+ * Caching policy is configured per address range, anything outside of
+ * the configured ranges is uncached. Lines are filled in full using
+ * dap_peek_many, so do not cache ranges where reads have side effects.
+ */
+
+enum dap_cache_policy {
+	/* Always go to the target. */
+	DAP_CACHE_UNCACHED = 0,
+
+	/* Cache reads, write to the target immediately. */
+	DAP_CACHE_WRITE_THROUGH,
+
+	/* Cache reads and writes, write on flush or eviction. */
+	DAP_CACHE_WRITE_BACK,
+};
+
+/*
+ * Set caching policy for [start, end).
+ *
+ * Later ranges take precedence. Returns false if there is no room left.
+ */
+bool dap_cache_range(uint32_t start, uint32_t end, enum dap_cache_policy policy);
+
+/*
+ * Read word from target's memory through the cache.
+ */
+bool dap_cache_peek(uint32_t addr, uint32_t *value);
+
+/*
+ * Write word to target's memory through the cache.
+ */
+bool dap_cache_poke(uint32_t addr, uint32_t value);
+
+/*
+ * Write all dirty words back to the target.
+ */
+bool dap_cache_flush(void);
+
+/*
+ * Forget cached contents of [start, end) without writing them back.
+ */
+void dap_cache_invalidate(uint32_t start, uint32_t end);
+
+/*
+ * Forget all cached contents and policies, e.g. after a reconnect.
+ */
+void dap_cache_reset(void);
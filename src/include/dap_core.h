@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Access to the core registers of the currently selected target.
+ */
+
+enum dap_core_reg {
+	DAP_CORE_R0 = 0,
+	DAP_CORE_SP = 13,
+	DAP_CORE_LR = 14,
+	DAP_CORE_PC = 15,
+	DAP_CORE_XPSR = 16,
+	DAP_CORE_MSP = 17,
+	DAP_CORE_PSP = 18,
+	DAP_CORE_NUM_REGS,
+};
+
+/*
+ * Halt the core and wait until it stops.
+ *
+ * Optionally report whether it was already halted before.
+ */
+bool dap_core_halt(bool *was_halted);
+
+/*
+ * Let the core run again.
+ */
+bool dap_core_resume(void);
+
+/*
+ * Read all registers of a halted core.
+ *
+ * Register selection and readout are pipelined, so that every register
+ * costs just three SWD transactions. S_REGRDY is only checked once
+ * at the end.
+ */
+bool dap_core_read_regs(uint32_t regs[DAP_CORE_NUM_REGS]);
+
+/*
+ * Write all registers of a halted core.
+ */
+bool dap_core_write_regs(const uint32_t regs[DAP_CORE_NUM_REGS]);
+
+/*
+ * Halt the core if needed, read its registers and let it continue.
+ */
+bool dap_core_snapshot(uint32_t regs[DAP_CORE_NUM_REGS]);
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Randomised conformance test of the target memory access functions.
+ *
+ * Runs random peeks and pokes of random lengths against a scratch window
+ * of the target memory and checks every word read against a model of
+ * what has been written there. Combine with dap_inject to exercise the
+ * error paths as well.
+ *
+ * Failed transfers are reported to the link, which recovers the same way
+ * it does during normal operation. Since a posted write may have been
+ * lost before the failure was noticed, the model then forgets everything.
+ */
+
+struct dap_fuzz_report {
+	/* Operations attempted and how many of them failed. */
+	unsigned ops;
+	unsigned failed;
+
+	/* Conformance problems, these must stay zero. */
+	unsigned mismatches;
+	unsigned overruns;
+	unsigned silent;
+};
+
+/*
+ * Run given number of random operations, starting from the seed.
+ *
+ * Returns false when a conformance problem was found or when the link
+ * could not be brought back up.
+ */
+bool dap_fuzz(uint32_t seed, unsigned rounds, struct dap_fuzz_report *report);
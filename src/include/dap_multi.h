@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dap.h"
+
+/*
+ * Drive several independent SWD links in lock-step.
+ *
+ * All links share a single SWCLK pin and have their own SWDIO pin.
+ * Requests and written data are broadcast, acknowledgements and read
+ * data are collected for every link separately, so that working with
+ * N boards takes about as long as working with one.
+ *
+ * Every function takes a mask of links to talk to (bit N for link N)
+ * and returns the mask of links where it succeeded. Links left out
+ * just see an idle line. Callers usually pass the result on to the
+ * next step so that failed boards drop out.
+ */
+
+#define DAP_MULTI_MAX_LINKS 16
+
+/*
+ * Initialize links using given pins.
+ *
+ * Returns mask of all links.
+ */
+uint32_t dap_multi_init(int swclk, const int *swdio, int num_links);
+
+/*
+ * Adjust the SWD bit period after clk_sys has changed. See dap_set_clock.
+ */
+void dap_multi_set_clock(uint32_t sys_hz, uint32_t swd_hz);
+
+/*
+ * Reinitialize the communication links. See dap_reset.
+ */
+void dap_multi_reset(void);
+
+/*
+ * Select the same multidrop target on all links.
+ */
+void dap_multi_select_target(uint32_t target);
+
+/*
+ * Read IDCODE from all links.
+ */
+uint32_t dap_multi_read_idcode(uint32_t links, uint32_t *idcodes);
+
+/*
+ * Configure targets for memory access. See dap_setup_mem.
+ */
+uint32_t dap_multi_setup_mem(uint32_t links);
+
+/*
+ * Write the same value to a register on all links.
+ */
+uint32_t dap_multi_set_reg(enum dap_register reg, uint32_t value, uint32_t links);
+
+/*
+ * Read a register on all links, values are indexed by link.
+ */
+uint32_t dap_multi_get_reg(enum dap_register reg, uint32_t *values, uint32_t links);
+
+/*
+ * Read a word from memory of all targets.
+ */
+uint32_t dap_multi_peek(uint32_t addr, uint32_t *values, uint32_t links);
+
+/*
+ * Read a block from memory of all targets, len words per link.
+ *
+ * Words read from link N are stored at values + N * len.
+ * Transfers may cross 1 KiB boundaries.
+ */
+uint32_t dap_multi_peek_many(uint32_t addr, uint32_t *values, int len, uint32_t links);
+
+/*
+ * Write the same word into memory of all targets.
+ */
+uint32_t dap_multi_poke(uint32_t addr, uint32_t value, uint32_t links);
+
+/*
+ * Write the same block into memory of all targets.
+ */
+uint32_t dap_multi_poke_many(uint32_t addr, const uint32_t *values, int len, uint32_t links);
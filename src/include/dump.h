@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Stream target memory over stdio as compressed, checksummed frames.
+ *
+ * Every frame is laid out as (little endian):
+ *
+ *  - magic "DUMP"
+ *  - u32 address of the first word
+ *  - u16 number of words, 0 marks the end of the dump
+ *  - u16 length of the payload
+ *  - payload
+ *  - u32 CRC32 of everything above, excluding the magic
+ *
+ * The payload is a sequence of runs. Control byte c < 0x80 is followed
+ * by c + 1 literal words, c >= 0x80 by a single word repeated c - 0x7f
+ * times.
+ *
+ * The final frame carries the number of words that could not be read
+ * in its address field. See tools/dump.py for the receiving side.
+ *
+ * Ranges that wrap around the end of the address space are rejected
+ * before anything is sent.
+ */
+bool dump_stream(uint32_t addr, uint32_t len);
+
+/*
+ * Compress words into out, which must hold at least n * 4 + n / 128 + 1
+ * bytes. Returns length of the output.
+ */
+int dump_compress(const uint32_t *words, int n, uint8_t *out);
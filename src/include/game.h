@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Simulation runs at a fixed rate, independent of the frame rate.
+ */
+#define TICK_RATE 200
+#define TICK_US (1000 * 1000 / TICK_RATE)
+
+/*
+ * Hamsters start with this many hearts.
+ */
+#define GAME_MAX_HP 3
+
+struct hamster {
+	float y;
+	float dy;
+	float px, py;
+	int hp;
+};
+
+/*
+ * Complete simulation state. Plain data, so that it can be snapshotted
+ * and restored by copying the structure.
+ */
+struct game {
+	struct hamster p1, p2;
+};
+
+/*
+ * Put both hamsters back to the floor with full health.
+ */
+void game_reset(struct game *game);
+
+/*
+ * Advance the game by one tick.
+ *
+ * Bit N of buttons corresponds to enum input_button N. Only sounds of
+ * audible ticks are played, so that re-simulated ticks stay quiet.
+ */
+void game_step(struct game *game, uint32_t buttons, bool audible);
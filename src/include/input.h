@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+enum input_button {
+	INPUT_P1_UP = 0,
+	INPUT_P1_GUN,
+	INPUT_P2_UP,
+	INPUT_P2_GUN,
+	INPUT_SELECT,
+	INPUT_NUM_BUTTONS,
+};
+
+struct input_event {
+	/* time_us_32() of the sample that saw the edge */
+	uint32_t time;
+	uint8_t button;
+	bool pressed;
+};
+
+/*
+ * Feed a sample of all buttons taken at the given time.
+ *
+ * Bit N of pressed and changed corresponds to enum input_button N, where
+ * changed marks buttons with an edge latched since the previous sample.
+ * Edges are pushed into the event queue right away and further changes
+ * of the same button are ignored for the next INPUT_DEBOUNCE samples.
+ *
+ * Must only be called from a single producer.
+ */
+void input_sample(uint32_t time, uint32_t pressed, uint32_t changed);
+
+/*
+ * Return debounced state of all buttons as a bit mask.
+ */
+uint32_t input_state(void);
+
+/*
+ * Pop the oldest event, but only if it happened before the deadline.
+ *
+ * Returns false when the queue is empty or the oldest event is newer.
+ * Must only be called from a single consumer.
+ */
+bool input_pop_until(uint32_t deadline, struct input_event *event);
+
+/*
+ * Return number of events dropped due to a full queue and reset it.
+ */
+unsigned input_dropped_reset(void);
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sprite.h"
+
+/*
+ * Horizontal run of pixels of a single color.
+ */
+struct layer_span {
+	int16_t y, x0, x1;
+	uint8_t color;
+};
+
+/*
+ * Pre-rendered layer that is composited onto every frame.
+ *
+ * Layers are rendered into a list of spans only when their inputs change
+ * and then merged into the frame buffer using tft_draw_rect, which makes
+ * the per-frame cost proportional to the number of runs, not pixels.
+ */
+struct layer {
+	struct layer_span *spans;
+	int max_spans;
+	int len;
+
+	/* Inputs the layer was last rendered with. */
+	uint32_t key;
+	bool valid;
+};
+
+#define LAYER_INIT(storage) \
+	{ .spans = (storage), .max_spans = sizeof(storage) / sizeof(*(storage)) }
+
+/*
+ * Check whether the layer needs to be rendered again for given inputs.
+ *
+ * Returns true and empties the layer if so. The caller is then expected
+ * to add new contents.
+ */
+bool layer_stale(struct layer *layer, uint32_t key);
+
+/*
+ * Add a span to the layer.
+ *
+ * Returns false when the layer is full.
+ */
+bool layer_add_span(struct layer *layer, int y, int x0, int x1, int color);
+
+/*
+ * Add visible pixels of a sprite at given position.
+ */
+bool layer_add_sprite(struct layer *layer, const struct sprite *sprite, int x, int y,
+		      int color);
+
+/*
+ * Merge the layer into the frame buffer.
+ */
+void layer_draw(const struct layer *layer);
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Keeps the SWD link to the slave healthy.
+ *
+ * Users report failed transactions with link_failed, which clears sticky
+ * errors through ABORT when that is enough and otherwise marks the link
+ * down. While down, link_up attempts a full reconnect, backing off
+ * exponentially between attempts so that a missing slave costs at most
+ * one short attempt per period.
+ */
+
+/*
+ * Connect to given multidrop target.
+ *
+ * The setup callback is invoked after every successful connection to
+ * configure the slave again, as it may have been reset meanwhile.
+ */
+bool link_init(uint32_t target, void (*setup)(void));
+
+/*
+ * Return true if the link is usable, trying to reconnect when due.
+ */
+bool link_up(void);
+
+/*
+ * Switch to another target on the same multidrop bus.
+ *
+ * Reconnects will then also go to that target.
+ */
+bool link_select(uint32_t target);
+
+/*
+ * Report that a DAP transaction has just failed.
+ */
+void link_failed(void);
+
+/*
+ * Print and reset link error counters.
+ */
+void link_stats_report_reset(void);
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "layer.h"
+
+/*
+ * Mirror the game screen into the slave's SRAM over SWD.
+ *
+ * The master keeps a shadow copy of the logical screen, one palette index
+ * per pixel, and pushes rows that changed into one of two frame buffers
+ * in the slave memory, laid out at MIRROR_BASE as:
+ *
+ *  +0   magic, MIRROR_MAGIC
+ *  +4   sequence number of the last published frame
+ *  +8   index of the buffer holding that frame
+ *  +12  sequence number of the frame the slave is displaying
+ *  +16  two buffers of MIRROR_WIDTH * MIRROR_HEIGHT bytes
+ *
+ * followed by the palette and a resident scan-out loop that mirror_push
+ * uploads and starts on slave core 0 when bringing the display up. The
+ * loop waits for a new sequence number, acknowledges it in +12 and sends
+ * that buffer to its display.
+ * The master never writes into the buffer the slave is displaying.
+ */
+
+#if !defined(MIRROR_BASE)
+#define MIRROR_BASE 0x20020000u
+#endif
+
+#define MIRROR_MAGIC 0x5252494du
+#define MIRROR_WIDTH 160
+#define MIRROR_HEIGHT 120
+
+enum mirror_result {
+	/* Nothing has been submitted. */
+	MIRROR_IDLE = 0,
+
+	/* Slave still shows the previous frame, the new one was dropped. */
+	MIRROR_BUSY,
+
+	/* Frame is on its way to the slave display. */
+	MIRROR_PUSHED,
+
+	/* Transfer or display bring-up failed, see dap_last_error. */
+	MIRROR_FAILED,
+
+	/* Slave display is not up, bring-up will be retried later. */
+	MIRROR_DOWN,
+};
+
+/*
+ * Forget everything about the slave after it may have been reset.
+ *
+ * The next mirror_push brings its display up again.
+ */
+void mirror_reset(void);
+
+/*
+ * Draw into the shadow screen. Call from the rendering core.
+ */
+void mirror_fill(int color);
+void mirror_rect(int x0, int y0, int x1, int y1, int color);
+void mirror_layer(const struct layer *layer);
+
+/*
+ * Hand the finished shadow screen over to the SWD core.
+ *
+ * Drops the frame if the previous one is still being pushed.
+ */
+void mirror_submit(void);
+
+/*
+ * Push the submitted frame to the slave. Call from a task on the SWD core.
+ *
+ * Bringing the slave display up sleeps the calling task for about 250 ms
+ * while the display comes out of reset.
+ */
+enum mirror_result mirror_push(void);
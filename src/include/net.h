@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <game.h>
+
+/*
+ * Lock-step play against another console, relayed over the USB serial link.
+ *
+ * Both sides first exchange "sync <player>" lines until each has heard from
+ * the other, so they may be started in any order. Then every tick they
+ * exchange their own buttons as "input <tick> <bits>" lines, scheduled
+ * NET_DELAY ticks ahead. Missing remote input is predicted by repeating
+ * the last one and corrected later by restoring a snapshot and
+ * re-simulating the ticks since, without sound.
+ *
+ * Lines are produced by the game core and printed by the console, which
+ * owns the serial link.
+ */
+
+/*
+ * Start a session as the given player (0 or 1) from a fresh game.
+ * Called from the console core.
+ */
+bool net_start(int player);
+
+/*
+ * End the session, the game continues with local input only.
+ */
+bool net_stop(void);
+
+/*
+ * Queue a sync line from the remote player.
+ *
+ * Returns false when the queue is full and the caller should retry later.
+ */
+bool net_receive_sync(int player);
+
+/*
+ * Queue buttons the remote player had at the given tick.
+ *
+ * Returns false when the queue is full and the caller should retry later.
+ */
+bool net_receive(uint32_t tick, uint8_t bits);
+
+/*
+ * Format the next line to print, if there is one. These are lines for
+ * the remote player and our own status messages, in the order the game
+ * core produced them. Called from the console core.
+ */
+bool net_output(char *line, int size);
+
+/*
+ * Return whether a session has been started.
+ */
+bool net_active(void);
+
+/*
+ * Advance the game by one tick, rolling back first if a misprediction has
+ * been discovered. Without a session just steps the game with the buttons.
+ *
+ * Returns false without advancing while waiting for the remote player
+ * or for the console to send our input.
+ * Must only be called from the core running the game.
+ */
+bool net_tick(struct game *game, uint32_t buttons);
+
+/*
+ * Print and reset rollback statistics.
+ */
+void net_stats_report_reset(void);
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <hardware/sync.h>
+
+/*
+ * Single producer, single consumer ring, safe across cores and from
+ * interrupts.
+ *
+ * Only keeps track of the slots, the entries live in an array of the
+ * user with a power of two size. The producer fills the slot returned
+ * by ring_claim and then calls ring_publish, the consumer copies out the
+ * slot returned by ring_peek and then calls ring_release. Both return
+ * -1 when there is no slot to work with.
+ */
+struct ring {
+	/* Written only by the producer. */
+	volatile unsigned head;
+
+	/* Written only by the consumer. */
+	volatile unsigned tail;
+};
+
+static inline int ring_claim(struct ring *ring, unsigned size)
+{
+	unsigned head = ring->head;
+
+	if (head - ring->tail >= size)
+		return -1;
+
+	return head & (size - 1);
+}
+
+static inline void ring_publish(struct ring *ring)
+{
+	/* Publish the slot only after it has been fully written. */
+	__dmb();
+	ring->head = ring->head + 1;
+}
+
+static inline int ring_peek(struct ring *ring, unsigned size)
+{
+	unsigned tail = ring->tail;
+
+	if (tail == ring->head)
+		return -1;
+
+	/* Pairs with the barrier in ring_publish. */
+	__dmb();
+	return tail & (size - 1);
+}
+
+static inline void ring_release(struct ring *ring)
+{
+	/* Release the slot only after it has been copied out. */
+	__dmb();
+	ring->tail = ring->tail + 1;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+enum sprite_flags {
+	/* Data are per-row runs instead of a packed bitmap. */
+	SPRITE_RLE = 1 << 0,
+
+	/* Runs carry their own palette index. */
+	SPRITE_INDEXED = 1 << 1,
+};
+
+/*
+ * Sprite cropped to the bounding box of its visible pixels.
+ *
+ * Sprites are generated by tools/sprites.py from images in sprites/.
+ *
+ * Packed bitmaps store every row in (w + 7) / 8 bytes, leftmost pixel
+ * in the MSB. Runs are stored as a byte with the number of runs in the
+ * row, followed by x offset and length of every run and, for indexed
+ * sprites, its color.
+ */
+struct sprite {
+	/* Offset of the bounding box within the source image. */
+	uint8_t x, y;
+	uint8_t w, h;
+	uint8_t flags;
+	const uint8_t *data;
+};
+
+/*
+ * Called for every horizontal run of visible pixels.
+ */
+typedef bool (*sprite_span_fn)(void *arg, int y, int x0, int x1, int color);
+
+/*
+ * Walk all runs of visible pixels of a sprite placed at given position.
+ *
+ * Monochrome sprites use the color passed in. Stops early and returns
+ * false when the callback does.
+ */
+bool sprite_spans(const struct sprite *sprite, int x, int y, int color, sprite_span_fn fn,
+		  void *arg);
+
+/*
+ * Draw sprite at given position, skipping transparent pixels.
+ */
+void sprite_draw(const struct sprite *sprite, int x, int y, int color);
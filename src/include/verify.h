@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Compute CRC32 of target memory on the target itself.
+ *
+ * Uses a DMA channel of the slave with its CRC sniffer enabled to read
+ * through the range, so that only the resulting checksum travels over
+ * SWD. The result matches crc32_update(0, data, len).
+ *
+ * Takes the slave's DMA out of reset and claims channel VERIFY_CHANNEL
+ * and the sniffer, releasing them again when done. The data is written
+ * into the VERIFY_SINK word of slave SRAM. Flash can only be checked
+ * through XIP while it is enabled on the slave. Both address and length
+ * must be multiples of 4.
+ */
+bool verify_crc32(uint32_t addr, uint32_t len, uint32_t *crc);
+
+/*
+ * Compare target memory with a local copy using verify_crc32.
+ *
+ * Sets match and returns true if the checksum could be obtained.
+ */
+bool verify_memory(uint32_t addr, const void *data, uint32_t len, bool *match);
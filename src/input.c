@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <assert.h>
+
+#include <ring.h>
+
+#include "input.h"
+
+/*
+ * For how many samples to ignore a button after an edge, so that contact
+ * bounce does not register as more presses.
+ */
+#if !defined(INPUT_DEBOUNCE)
+#define INPUT_DEBOUNCE 3
+#endif
+
+/*
+ * Size of the event queue. Must be a power of two.
+ */
+#if !defined(INPUT_QUEUE_SIZE)
+#define INPUT_QUEUE_SIZE 64
+#endif
+
+static_assert(0 == (INPUT_QUEUE_SIZE & (INPUT_QUEUE_SIZE - 1)), "INPUT_QUEUE_SIZE must be a power of two");
+
+static struct input_event queue[INPUT_QUEUE_SIZE];
+static struct ring queue_ring;
+
+static volatile unsigned dropped;
+
+/* Debouncer state, owned by the producer. */
+static volatile uint32_t stable;
+static uint8_t holdoff[INPUT_NUM_BUTTONS];
+
+static void input_push(uint32_t time, int button, bool pressed)
+{
+	int slot = ring_claim(&queue_ring, INPUT_QUEUE_SIZE);
+
+	if (slot < 0) {
+		dropped++;
+		return;
+	}
+
+	struct input_event *event = &queue[slot];
+	event->time = time;
+	event->button = button;
+	event->pressed = pressed;
+
+	ring_publish(&queue_ring);
+}
+
+void input_sample(uint32_t time, uint32_t pressed, uint32_t changed)
+{
+	uint32_t state = stable;
+
+	for (int i = 0; i < INPUT_NUM_BUTTONS; i++) {
+		uint32_t bit = 1u << i;
+
+		if (holdoff[i]) {
+			holdoff[i]--;
+			continue;
+		}
+
+		/*
+		 * A latched edge with the level unchanged means the button
+		 * went the other way and back between samples. Report the
+		 * first half now, the level reports the second one later.
+		 */
+		if (!((pressed ^ state) & bit) && !(changed & bit))
+			continue;
+
+		state ^= bit;
+		input_push(time, i, state & bit);
+		holdoff[i] = INPUT_DEBOUNCE;
+	}
+
+	stable = state;
+}
+
+uint32_t input_state(void)
+{
+	return stable;
+}
+
+bool input_pop_until(uint32_t deadline, struct input_event *event)
+{
+	int slot = ring_peek(&queue_ring, INPUT_QUEUE_SIZE);
+
+	if (slot < 0)
+		return false;
+
+	const struct input_event *head = &queue[slot];
+
+	if ((int32_t)(deadline - head->time) <= 0)
+		return false;
+
+	*event = *head;
+	ring_release(&queue_ring);
+
+	return true;
+}
+
+unsigned input_dropped_reset(void)
+{
+	unsigned value = dropped;
+	dropped -= value;
+	return value;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <tft.h>
+
+#include "layer.h"
+
+bool layer_stale(struct layer *layer, uint32_t key)
+{
+	if (layer->valid && layer->key == key)
+		return false;
+
+	layer->key = key;
+	layer->valid = true;
+	layer->len = 0;
+
+	return true;
+}
+
+bool layer_add_span(struct layer *layer, int y, int x0, int x1, int color)
+{
+	if (layer->len >= layer->max_spans)
+		return false;
+
+	struct layer_span *span = &layer->spans[layer->len++];
+	span->y = y;
+	span->x0 = x0;
+	span->x1 = x1;
+	span->color = color;
+
+	return true;
+}
+
+static bool layer_add_sprite_span(void *arg, int y, int x0, int x1, int color)
+{
+	return layer_add_span(arg, y, x0, x1, color);
+}
+
+bool layer_add_sprite(struct layer *layer, const struct sprite *sprite, int x, int y,
+		      int color)
+{
+	return sprite_spans(sprite, x, y, color, layer_add_sprite_span, layer);
+}
+
+void layer_draw(const struct layer *layer)
+{
+	for (int i = 0; i < layer->len; i++) {
+		const struct layer_span *span = &layer->spans[i];
+		tft_draw_rect(span->x0, span->y, span->x1, span->y, span->color);
+	}
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <stdio.h>
+
+#include <dap.h>
+
+#include "link.h"
+
+/*
+ * Reconnect back-off bounds.
+ */
+#if !defined(LINK_BACKOFF_MIN_US)
+#define LINK_BACKOFF_MIN_US (10 * 1000)
+#endif
+
+#if !defined(LINK_BACKOFF_MAX_US)
+#define LINK_BACKOFF_MAX_US (1000 * 1000)
+#endif
+
+/* ABORT: STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR */
+#define ABORT_CLEAR_STICKY 0x1e
+
+/* ABORT: DAPABORT, cancels a transaction stuck in WAIT */
+#define ABORT_DAPABORT 0x01
+
+static uint32_t target_id;
+static void (*setup_fn)(void);
+
+static bool up = false;
+static uint32_t next_attempt;
+static uint32_t backoff = LINK_BACKOFF_MIN_US;
+
+static unsigned num_aborts;
+static unsigned num_drops;
+static unsigned num_reconnects;
+
+static bool link_connect(bool setup)
+{
+	dap_reset();
+	dap_select_target(target_id);
+
+	uint32_t idcode = dap_read_idcode();
+
+	if (0xffffffff == idcode)
+		return false;
+
+	uint32_t idr;
+
+	if (!dap_setup_mem(&idr))
+		return false;
+
+	printf("link: idcode = %#010x, idr = %#010x\n", (unsigned)idcode, (unsigned)idr);
+
+	dap_noop();
+
+	if (setup && setup_fn)
+		setup_fn();
+
+	return true;
+}
+
+bool link_init(uint32_t target, void (*setup)(void))
+{
+	target_id = target;
+	setup_fn = setup;
+
+	up = link_connect(true);
+	next_attempt = time_us_32();
+	backoff = LINK_BACKOFF_MIN_US;
+
+	return up;
+}
+
+bool link_up(void)
+{
+	if (up)
+		return true;
+
+	uint32_t now = time_us_32();
+
+	if ((int32_t)(now - next_attempt) < 0)
+		return false;
+
+	if (link_connect(true)) {
+		printf("link: reconnected after %u attempt(s)\n", num_reconnects + 1);
+		up = true;
+		num_reconnects = 0;
+		backoff = LINK_BACKOFF_MIN_US;
+		return true;
+	}
+
+	num_reconnects++;
+	next_attempt = time_us_32() + backoff;
+
+	if (backoff < LINK_BACKOFF_MAX_US)
+		backoff *= 2;
+
+	if (backoff > LINK_BACKOFF_MAX_US)
+		backoff = LINK_BACKOFF_MAX_US;
+
+	return false;
+}
+
+bool link_select(uint32_t target)
+{
+	/* Same device, only configure it again if it might have been reset. */
+	bool setup = !up;
+
+	if (target == target_id && up)
+		return true;
+
+	target_id = target;
+
+	if ((up = link_connect(setup)))
+		return true;
+
+	printf("link: failed to select %#010x\n", (unsigned)target);
+	next_attempt = time_us_32();
+	backoff = LINK_BACKOFF_MIN_US;
+
+	return false;
+}
+
+void link_failed(void)
+{
+	if (!up)
+		return;
+
+	enum dap_error error = dap_last_error();
+	uint32_t abort = ABORT_CLEAR_STICKY;
+
+	switch (error) {
+	case DAP_ERR_NONE:
+		return;
+
+	case DAP_ERR_WAIT:
+		abort |= ABORT_DAPABORT;
+		/* fall through */
+
+	case DAP_ERR_FAULT:
+	case DAP_ERR_PARITY:
+		/* ABORT is always accepted, even while the AP is busy. */
+		if (dap_set_reg(DAP_DP0, abort)) {
+			num_aborts++;
+			return;
+		}
+
+		break;
+
+	case DAP_ERR_PROTOCOL:
+		break;
+	}
+
+	printf("link: down (error %i)\n", error);
+	num_drops++;
+	up = false;
+
+	/* First attempt right away, a glitch is the most likely cause. */
+	next_attempt = time_us_32();
+	backoff = LINK_BACKOFF_MIN_US;
+}
+
+void link_stats_report_reset(void)
+{
+	printf("link: %s, %u aborts, %u drops\n", up ? "up" : "down", num_aborts, num_drops);
+
+	num_aborts = 0;
+	num_drops = 0;
+}
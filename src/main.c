@@ -19,7 +19,11 @@
 #include <pico/stdlib.h>
 
 #include <hardware/adc.h>
+#include <hardware/clocks.h>
 #include <hardware/pwm.h>
+#include <hardware/spi.h>
+#include <hardware/timer.h>
+#include <hardware/vreg.h>
 
 #include <string.h>
 #include <stdlib.h>
@@ -27,7 +31,22 @@
 
 #include <task.h>
 #include <tft.h>
+#include <audio.h>
 #include <dap.h>
+#include <dap_cache.h>
+#include <dap_core.h>
+#include <dap_fuzz.h>
+#include <dump.h>
+#include <game.h>
+#include <link.h>
+#include <verify.h>
+#include <input.h>
+#include <layer.h>
+#include <mirror.h>
+#include <net.h>
+#include <sounds.h>
+
+#include "sprites.h"
 
 #define DAP_SWDIO_PIN 25
 #define DAP_SWCLK_PIN 24
@@ -51,78 +70,77 @@
 #define SLAVE_START_PIN 19
 #define SLAVE_SELECT_PIN 20
 
-static bool p1_up_btn = 0;
-static bool p1_gun_btn = 0;
+/*
+ * Performance profile raises core voltage and clk_sys at startup,
+ * clk_peri follows clk_sys. SPI divider is recomputed by tft_init,
+ * SWD delay by dap_set_clock.
+ */
+#if !defined(PERF_PROFILE)
+#define PERF_PROFILE 0
+#endif
 
-static bool p2_up_btn = 0;
-static bool p2_gun_btn = 0;
+#define PERF_SYS_KHZ 250000
+#define PERF_VREG VREG_VOLTAGE_1_20
+#define PERF_SWD_HZ 2000000
 
-static void stats_task(void);
-static void tft_task(void);
-static void input_task(void);
+/*
+ * Mirror the screen into the slave memory for its own display.
+ */
+#if !defined(MIRROR)
+#define MIRROR 0
+#endif
 
-struct hamster {
-	float y;
-	float dy;
-	uint8_t color;
-	float px, py;
-	int hp;
-};
+/* Give up catching up after this many ticks in a single frame. */
+#define MAX_CATCHUP 8
 
-static struct hamster p1, p2;
-
-uint32_t heart_sprite[32] = {
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00011100011100000000000000000000, /* do not wrap please */
-	0b00111110111110000000000000000000, /* do not wrap please */
-	0b01111111111111000000000000000000, /* do not wrap please */
-	0b01111111111111000000000000000000, /* do not wrap please */
-	0b01111111111111000000000000000000, /* do not wrap please */
-	0b01111111111111000000000000000000, /* do not wrap please */
-	0b00111111111110000000000000000000, /* do not wrap please */
-	0b00011111111100000000000000000000, /* do not wrap please */
-	0b00001111111000000000000000000000, /* do not wrap please */
-	0b00000111110000000000000000000000, /* do not wrap please */
-	0b00000011100000000000000000000000, /* do not wrap please */
-	0b00000001000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-	0b00000000000000000000000000000000, /* do not wrap please */
-};
+/*
+ * Cap frame rate to save power, 0 renders as fast as possible.
+ */
+#if !defined(FRAME_CAP_HZ)
+#define FRAME_CAP_HZ 0
+#endif
 
-static void draw_sprite(int x0, int y0, uint32_t sprite[32], int color, bool transp)
-{
-	int x1 = x0 + 32;
-	int y1 = y0 + 32;
+/*
+ * Time spent doing actual work on every core, for the idle report.
+ * Core 0 has no idle path of its own, so whatever its tasks do not
+ * account for, the scheduler included, is reported as idle.
+ */
+static volatile uint32_t busy_us[NUM_CORES];
 
-	for (int y = y0; y < y1; y++) {
-		for (int x = x0; x < x1; x++) {
-			bool visible = (sprite[(y - y0)] << (x - x0)) >> 31;
+/* Buttons held at the end of the last tick. */
+static uint32_t held = 0;
 
-			if (!visible && transp)
-				continue;
+/* Presses not yet seen by a tick that actually ran. */
+static uint32_t pressed_unseen = 0;
 
-			int c = color * visible;
-			tft_draw_pixel(x, y, c);
-		}
-	}
-}
+/* Earliest press consumed since the last frame was shown. */
+static uint32_t press_pending = 0;
+static bool press_is_pending = false;
+
+/* Button-to-photon latency, reported by the stats task. */
+static uint32_t latency_max = 0;
+static uint32_t latency_sum = 0;
+static uint32_t latency_count = 0;
+
+static void stats_task(void);
+static void tft_task(void);
+static void input_task(void);
+__unused static void mirror_task(void);
+static void console_task(void);
+
+static struct game game;
+
+/*
+ * How often to refresh the FPS counter.
+ */
+#define FPS_PERIOD_US (500 * 1000)
+
+/*
+ * Runs in a single heart and a single digit, layers are sized by them.
+ */
+#define HEART_MAX_SPANS 16
+#define DIGIT_MAX_SPANS 14
+#define DIGIT_WIDTH 6
 
 #define WIDTH 160
 #define HEIGHT 120
@@ -135,6 +153,10 @@ task_t task_avail[NUM_CORES][MAX_TASKS] = {
 		/* On the first core: */
 		MAKE_TASK(4, "stats", stats_task),
 		MAKE_TASK(1, "input", input_task),
+		MAKE_TASK(2, "console", console_task),
+#if MIRROR
+		MAKE_TASK(1, "mirror", mirror_task),
+#endif
 		NULL,
 	},
 	{
@@ -144,51 +166,415 @@ task_t task_avail[NUM_CORES][MAX_TASKS] = {
 	},
 };
 
+/*
+ * Adds time since given timestamp to the current core's busy counter.
+ */
+static void account_busy(uint32_t since)
+{
+	busy_us[get_core_num()] += time_us_32() - since;
+}
+
 /*
  * Reports on all running tasks every 10 seconds.
  */
 static void stats_task(void)
 {
+	uint32_t last_report = time_us_32();
+	uint32_t last_busy[NUM_CORES] = { 0 };
+
 	while (true) {
 		task_sleep_ms(10 * 1000);
 
-		for (unsigned i = 0; i < NUM_CORES; i++)
+		uint32_t now = time_us_32();
+		uint32_t elapsed = now - last_report;
+		last_report = now;
+
+		for (unsigned i = 0; i < NUM_CORES; i++) {
 			task_stats_report_reset(i);
+
+			/* Each core only ever adds to its own counter. */
+			uint32_t busy = busy_us[i] - last_busy[i];
+			last_busy[i] += busy;
+
+			unsigned idle = busy < elapsed ? 100 - (uint64_t)busy * 100 / elapsed : 0;
+			printf("core %u: %u%% idle%s\n", i, idle, i ? "" : " (scheduler included)");
+		}
+
+		link_stats_report_reset();
+		audio_stats_report_reset();
+		net_stats_report_reset();
+
+		uint32_t count = latency_count;
+		uint32_t sum = latency_sum;
+		uint32_t max = latency_max;
+
+		latency_count = 0;
+		latency_sum = 0;
+		latency_max = 0;
+
+		printf("input: %u presses, latency avg=%uus max=%uus, %u dropped\n",
+		       (unsigned)count, count ? (unsigned)(sum / count) : 0, (unsigned)max,
+		       input_dropped_reset());
 	}
 }
 
-inline static int slave_gpio_get(int pin)
+/*
+ * Raw interrupt status of slave GPIOs 16 to 31 in two registers, each pin
+ * with four bits: level low, level high, edge low and edge high.
+ */
+#define SLAVE_INTR2 0x400140f8
+#define INTR_LEVEL_HIGH 0x2
+#define INTR_EDGES 0xc
+
+/*
+ * Reads button levels and edges latched since the last call.
+ *
+ * Bit N of pressed and changed corresponds to pins[N]. Edges catch
+ * presses shorter than the sampling period.
+ */
+static bool slave_buttons(const int *pins, int len, uint32_t *pressed, uint32_t *changed)
 {
-	uint32_t tmp;
+	uint32_t intr[2];
+	uint32_t clear[2] = { 0, 0 };
 
-	if (!dap_peek(0x40014000 + 8 * pin, &tmp)) {
-		puts("slave_gpio_get: dap_peek failed");
-		return 0;
+	if (!dap_peek_many(SLAVE_INTR2, intr, 2)) {
+		link_failed();
+		return false;
 	}
 
-	return (tmp >> 17) & 1;
+	*pressed = 0;
+	*changed = 0;
+
+	for (int i = 0; i < len; i++) {
+		int reg = (pins[i] - 16) / 8;
+		int shift = 4 * (pins[i] % 8);
+		uint32_t bits = intr[reg] >> shift;
+
+		/* Buttons pull the line low. */
+		if (!(bits & INTR_LEVEL_HIGH))
+			*pressed |= 1u << i;
+
+		if (bits & INTR_EDGES) {
+			*changed |= 1u << i;
+			clear[reg] |= INTR_EDGES << shift;
+		}
+	}
+
+	/* Edge bits are write one to clear, level bits ignore writes. */
+	if ((clear[0] | clear[1]) && !dap_poke_many(SLAVE_INTR2, clear, 2)) {
+		link_failed();
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Configures the slave after every (re)connect.
+ */
+static void slave_setup(void)
+{
+	/* Anything we have cached is stale now. */
+	dap_cache_reset();
+
+	/* Pad configuration is static, batch it up. */
+	dap_cache_range(0x4001c000, 0x4001c080, DAP_CACHE_WRITE_BACK);
+
+	/* Un-reset stuff that's ok with clk_sys and clk_ref */
+	dap_poke(0x4000c000, 0x1e3bc9d);
+
+	/* Enable display backlight. */
+	dap_poke(0x4001406c, 0x331f);
+
+	/* Enable button input + pull-ups. */
+	dap_cache_poke(0x4001c000 + 4 + 4 * SLAVE_A_PIN, (1 << 3) | (1 << 6));
+	dap_cache_poke(0x4001c000 + 4 + 4 * SLAVE_B_PIN, (1 << 3) | (1 << 6));
+	dap_cache_poke(0x4001c000 + 4 + 4 * SLAVE_X_PIN, (1 << 3) | (1 << 6));
+	dap_cache_poke(0x4001c000 + 4 + 4 * SLAVE_Y_PIN, (1 << 3) | (1 << 6));
+
+	dap_cache_poke(0x4001c000 + 4 + 4 * SLAVE_SELECT_PIN, (1 << 3) | (1 << 6));
+
+	dap_cache_flush();
+
+	/* Forget edges latched before we were watching. */
+	uint32_t edges[2] = { 0xcccccccc, 0xcccccccc };
+	dap_poke_many(SLAVE_INTR2, edges, 2);
+
+	/* Make sure we do not turn outselves off. */
+	dap_poke(0x40018004, 0x001f);
+
+	if (MIRROR)
+		mirror_reset();
 }
 
 /*
- * Processes joystick and button inputs.
+ * Samples buttons, debounces them and queues timestamped edges.
  */
 static void input_task(void)
 {
 	task_sleep_ms(300);
 
 	while (true) {
-		p1_up_btn = !slave_gpio_get(SLAVE_A_PIN);
-		p1_gun_btn = !slave_gpio_get(SLAVE_B_PIN);
+		static const int pins[INPUT_NUM_BUTTONS] = {
+			[INPUT_P1_UP] = SLAVE_A_PIN,
+			[INPUT_P1_GUN] = SLAVE_B_PIN,
+			[INPUT_P2_UP] = SLAVE_X_PIN,
+			[INPUT_P2_GUN] = SLAVE_Y_PIN,
+			[INPUT_SELECT] = SLAVE_SELECT_PIN,
+		};
+
+		uint32_t now = time_us_32();
+		uint32_t pressed = 0;
+		uint32_t changed = 0;
+
+		/* Treat buttons as released while the link is down. */
+		if (link_up() && !slave_buttons(pins, INPUT_NUM_BUTTONS, &pressed, &changed)) {
+			pressed = 0;
+			changed = 0;
+		}
 
-		p2_up_btn = !slave_gpio_get(SLAVE_X_PIN);
-		p2_gun_btn = !slave_gpio_get(SLAVE_Y_PIN);
+		uint32_t before = input_state();
+		input_sample(now, pressed, changed);
+		uint32_t after = input_state();
 
-		if (!slave_gpio_get(SLAVE_SELECT_PIN)) {
+		if ((after & ~before) & (1u << INPUT_SELECT)) {
 			puts("SELECT");
 			dap_poke(0x40018004, 0x331f);
 		}
 
-		task_sleep_ms(10);
+		account_busy(now);
+		task_sleep_ms(1);
+	}
+}
+
+/*
+ * Pushes finished frames to the slave.
+ */
+__unused static void mirror_task(void)
+{
+	task_sleep_ms(300);
+
+	while (true) {
+		uint32_t started = time_us_32();
+
+		if (link_up() && MIRROR_FAILED == mirror_push())
+			link_failed();
+
+		account_busy(started);
+		task_sleep_ms(1);
+	}
+}
+
+static void console_command(char *line)
+{
+	char *cmd = strtok(line, " ");
+
+	if (!cmd)
+		return;
+
+	if (!strcmp(cmd, "input")) {
+		char *tick = strtok(NULL, " ");
+		char *bits = strtok(NULL, " ");
+
+		if (!tick || !bits)
+			return;
+
+		/* Make the relay wait rather than lose input. */
+		while (!net_receive(strtoul(tick, NULL, 0), strtoul(bits, NULL, 0)))
+			task_sleep_ms(1);
+
+		return;
+	}
+
+	if (!strcmp(cmd, "sync")) {
+		char *player = strtok(NULL, " ");
+
+		if (!player || ('1' != *player && '2' != *player))
+			return;
+
+		while (!net_receive_sync(*player - '1'))
+			task_sleep_ms(1);
+
+		return;
+	}
+
+	if (!strcmp(cmd, "net")) {
+		char *arg = strtok(NULL, " ");
+
+		if (arg && !strcmp(arg, "off")) {
+			while (!net_stop())
+				task_sleep_ms(1);
+
+			return;
+		}
+
+		if (!arg || ('1' != *arg && '2' != *arg)) {
+			puts("usage: net <1|2|off>");
+			return;
+		}
+
+		while (!net_start(*arg - '1'))
+			task_sleep_ms(1);
+
+		return;
+	}
+
+	if (!strcmp(cmd, "dump")) {
+		char *addr = strtok(NULL, " ");
+		char *len = strtok(NULL, " ");
+
+		if (!addr || !len) {
+			puts("usage: dump <addr> <len>");
+			return;
+		}
+
+		if (!link_up()) {
+			puts("dump: link down");
+			return;
+		}
+
+		if (!dump_stream(strtoul(addr, NULL, 0), strtoul(len, NULL, 0)))
+			link_failed();
+
+		return;
+	}
+
+	if (!strcmp(cmd, "crc")) {
+		char *addr = strtok(NULL, " ");
+		char *len = strtok(NULL, " ");
+		uint32_t crc;
+
+		if (!addr || !len) {
+			puts("usage: crc <addr> <len>");
+			return;
+		}
+
+		if (!link_up()) {
+			puts("crc: link down");
+			return;
+		}
+
+		if (verify_crc32(strtoul(addr, NULL, 0), strtoul(len, NULL, 0), &crc))
+			printf("crc = %#010x\n", (unsigned)crc);
+		else
+			link_failed();
+
+		return;
+	}
+
+	if (!strcmp(cmd, "fuzz")) {
+		char *rounds = strtok(NULL, " ");
+		char *odds = strtok(NULL, " ");
+		char *seed = strtok(NULL, " ");
+
+		if (!rounds) {
+			puts("usage: fuzz <rounds> [odds] [seed]");
+			return;
+		}
+
+		unsigned chance = odds ? strtoul(odds, NULL, 0) : 0;
+		struct dap_faults faults = { chance, chance, chance, chance };
+
+		if (chance && !dap_inject(&faults))
+			puts("fuzz: built without DAP_FAULT_INJECT, no faults injected");
+
+		struct dap_fuzz_report report;
+		dap_retries_reset();
+		dap_injected_reset(&faults);
+
+		bool ok = dap_fuzz(seed ? strtoul(seed, NULL, 0) : time_us_32(),
+				   strtoul(rounds, NULL, 0), &report);
+
+		dap_injected_reset(&faults);
+		dap_inject(&(struct dap_faults){ 0 });
+
+		printf("fuzz: %u ops, %u failed, %u mismatches, %u overruns, %u silent\n",
+		       report.ops, report.failed, report.mismatches, report.overruns,
+		       report.silent);
+		printf("fuzz: injected %u waits (%u retries), %u faults, %u parity, %u noise\n",
+		       faults.wait, dap_retries_reset(), faults.fault, faults.parity,
+		       faults.noise);
+		puts(ok ? "fuzz: pass" : "fuzz: FAIL");
+		return;
+	}
+
+	if (!strcmp(cmd, "regs")) {
+		char *core = strtok(NULL, " ");
+		uint32_t target = (core && '1' == *core) ? DAP_CORE1 : DAP_CORE0;
+		uint32_t regs[DAP_CORE_NUM_REGS];
+		bool ok;
+
+		if (!link_up()) {
+			puts("regs: link down");
+			return;
+		}
+
+		if ((ok = link_select(target)))
+			ok = dap_core_snapshot(regs);
+
+		if (!ok)
+			link_failed();
+
+		link_select(DAP_CORE0);
+
+		if (!ok)
+			return;
+
+		static const char *const names[] = { "sp", "lr", "pc", "xpsr", "msp", "psp" };
+
+		for (int i = 0; i < DAP_CORE_NUM_REGS; i++) {
+			char name[8];
+
+			if (i < DAP_CORE_SP)
+				snprintf(name, sizeof name, "r%i", i);
+			else
+				snprintf(name, sizeof name, "%s", names[i - DAP_CORE_SP]);
+
+			printf("%4s = %#010x%s", name, (unsigned)regs[i], (i % 4 == 3) ? "\n" : "  ");
+		}
+
+		puts("");
+		return;
+	}
+
+	printf("unknown command: %s\n", cmd);
+}
+
+/*
+ * Reads commands from the USB serial link.
+ */
+static void console_task(void)
+{
+	static char line[64];
+	static char out[32];
+	int len = 0;
+
+	while (true) {
+		/* Game core hands its protocol lines over to us. */
+		while (net_output(out, sizeof(out)))
+			puts(out);
+
+		int c = getchar_timeout_us(0);
+
+		if (PICO_ERROR_TIMEOUT == c) {
+			/* Keep the remote player's latency down. */
+			task_sleep_ms(net_active() ? 1 : 10);
+			continue;
+		}
+
+		if ('\r' == c || '\n' == c) {
+			uint32_t started = time_us_32();
+
+			line[len] = 0;
+			len = 0;
+			console_command(line);
+
+			account_busy(started);
+			continue;
+		}
+
+		if (len < (int)sizeof(line) - 1)
+			line[len++] = c;
 	}
 }
 
@@ -203,211 +589,289 @@ inline __unused static int clamp(int x, int lo, int hi)
 	return x;
 }
 
-static void reset_game(void)
+static void draw_fill(int color)
 {
-	p1.color = RED;
-	p1.dy = 0;
-	p1.y = tft_height - 31;
-	p1.px = -1;
-	p1.py = -1;
-	p1.hp = 3;
-
-	p2.color = GREEN;
-	p2.dy = 0;
-	p2.y = tft_height - 31;
-	p2.px = -1;
-	p2.py = -1;
-	p2.hp = 3;
+	tft_fill(color);
+
+	if (MIRROR)
+		mirror_fill(color);
 }
 
-/*
- * Outputs stuff to the screen as fast as possible.
- */
-static void tft_task(void)
+static void draw_rect(int x0, int y0, int x1, int y1, int color)
 {
-	uint32_t last_sync = time_us_32();
-	int fps = 30;
+	tft_draw_rect(x0, y0, x1, y1, color);
 
-	reset_game();
+	if (MIRROR)
+		mirror_rect(x0, y0, x1, y1, color);
+}
 
-	while (true) {
-		tft_fill(0);
+static void draw_layer(const struct layer *layer)
+{
+	layer_draw(layer);
 
-		float bottom = tft_height - 31;
+	if (MIRROR)
+		mirror_layer(layer);
+}
 
-		/*
-		 * Draw hamsters
-		 */
+/*
+ * Render a number right-aligned to given column.
+ */
+static bool layer_add_number(struct layer *layer, int x, int y, unsigned value, int color)
+{
+	static const struct sprite *const digits[10] = {
+		&sprite_digit0, &sprite_digit1, &sprite_digit2, &sprite_digit3, &sprite_digit4,
+		&sprite_digit5, &sprite_digit6, &sprite_digit7, &sprite_digit8, &sprite_digit9,
+	};
 
-		tft_draw_rect(0, p1.y, 23, p1.y + 31, p1.color);
-		tft_draw_rect(tft_width - 24, p2.y, tft_width - 1, p2.y + 31, p2.color);
+	do {
+		x -= DIGIT_WIDTH;
 
-		/*
-		 * Draw hearts
-		 */
+		if (!layer_add_sprite(layer, digits[value % 10], x + 1, y, color))
+			return false;
 
-		for (int i = 0; i < p1.hp; i++)
-			draw_sprite(28 + 16 * i, 4, heart_sprite, RED, true);
+		value /= 10;
+	} while (value);
 
-		for (int i = 0; i < p2.hp; i++)
-			draw_sprite(tft_width - 17 - (28 + 16 * i), 4, heart_sprite, GREEN, true);
+	return true;
+}
 
-		/*
-		 * Jumping
-		 */
+/*
+ * Advances the game by one tick, consuming input that happened before it.
+ * Returns false when the tick has to wait for the remote player.
+ */
+static bool game_tick(uint32_t deadline)
+{
+	struct input_event event;
 
-		if ((p1.y >= tft_height - 31) && p1_up_btn)
-			p1.dy = -tft_height * 1.15;
+	while (input_pop_until(deadline, &event)) {
+		uint32_t bit = 1u << event.button;
 
-		if ((p1.px < 0) && p1_gun_btn) {
-			p1.px = 24;
-			p1.py = p1.y + 16;
+		if (!event.pressed) {
+			held &= ~bit;
+			continue;
 		}
 
-		if ((p2.y >= tft_height - 31) && p2_up_btn)
-			p2.dy = -tft_height * 1.15;
+		held |= bit;
+		pressed_unseen |= bit;
 
-		if ((p2.px < 0) && p2_gun_btn) {
-			p2.px = tft_width - 25;
-			p2.py = p2.y + 16;
+		if (!press_is_pending) {
+			press_pending = event.time;
+			press_is_pending = true;
 		}
+	}
 
-		/*
-		 * Vertical movement
-		 */
+	/* Presses shorter than a tick still count, even if it had to wait. */
+	if (!net_tick(&game, held | pressed_unseen))
+		return false;
 
-		p1.y += p1.dy / fps;
-		p2.y += p2.dy / fps;
+	pressed_unseen = 0;
+	return true;
+}
 
-		/*
-		 * Gravitation
-		 */
+#if FRAME_CAP_HZ
+static void frame_alarm_fired(uint alarm)
+{
+	/* Waking the core up from WFE is all we need. */
+	(void)alarm;
+}
 
-		p1.dy += (float)tft_height / fps;
-		p2.dy += (float)tft_height / fps;
+/*
+ * Sleeps in WFE until the deadline or an earlier event.
+ */
+static void idle_until(uint64_t deadline)
+{
+	static int alarm = -1;
 
-		/*
-		 * Fall boosting
-		 */
+	if (alarm < 0) {
+		/* Callback fires on the core that sets it. */
+		alarm = hardware_alarm_claim_unused(true);
+		hardware_alarm_set_callback(alarm, frame_alarm_fired);
+	}
 
-		if (p1.dy > 0 && p1_up_btn) {
-			p1.dy += (float)tft_height / fps;
-		}
+	/* Deadline already passed. */
+	if (hardware_alarm_set_target(alarm, from_us_since_boot(deadline)))
+		return;
 
-		if (p2.dy > 0 && p2_up_btn) {
-			p2.dy += (float)tft_height / fps;
-		}
+	while (time_us_64() < deadline)
+		__wfe();
+}
+#endif
 
-		/*
-		 * Cap acceleration and keep hamsters above floor
-		 */
+/*
+ * Simulates the game in fixed ticks and outputs stuff to the screen,
+ * either as fast as possible or at most FRAME_CAP_HZ times a second.
+ */
+static void tft_task(void)
+{
+	uint32_t sim_time = time_us_32();
+	__unused uint64_t next_frame = time_us_64();
 
-		if (p1.dy > tft_height)
-			p1.dy = tft_height;
+	/* FPS is averaged over a longer period so that the text is stable. */
+	uint32_t fps_since = sim_time;
+	int fps_frames = 0;
+	int fps = 30;
 
-		if (p2.dy > tft_height)
-			p2.dy = tft_height;
+	static struct layer_span heart_spans[2 * GAME_MAX_HP * HEART_MAX_SPANS];
+	static struct layer hearts = LAYER_INIT(heart_spans);
 
-		if (p1.y >= bottom)
-			p1.y = bottom;
+	static struct layer_span fps_spans[4 * DIGIT_MAX_SPANS];
+	static struct layer fps_layer = LAYER_INIT(fps_spans);
 
-		if (p2.y >= bottom)
-			p2.y = bottom;
+	game_reset(&game);
 
+	while (true) {
 		/*
-		 * Draw projectiles
+		 * Run all ticks that are due
 		 */
 
-		if (p1.px >= 0)
-			tft_draw_rect(p1.px - 1, p1.py - 1, p1.px + 1, p1.py + 1, p1.color);
+		uint32_t now = time_us_32();
+		uint32_t started = now;
+
+		for (int i = 0; (int32_t)(now - sim_time) >= TICK_US; i++) {
+			if (i >= MAX_CATCHUP) {
+				/* Drop the backlog instead of spiralling. */
+				sim_time = now;
+				break;
+			}
+
+			if (!game_tick(sim_time + TICK_US)) {
+				/* Remote player is behind, let them catch up. */
+				sim_time = now;
+				break;
+			}
+
+			sim_time += TICK_US;
+		}
 
-		if (p2.px >= 0)
-			tft_draw_rect(p2.px - 1, p2.py - 1, p2.px + 1, p2.py + 1, p2.color);
+		draw_fill(0);
 
 		/*
-		 * Mid-air projectile collissions
+		 * Draw hamsters
 		 */
 
-		if (p1.px >= 0 && p2.px >= 0) {
-			if ((p1.py <= p2.py + 1) && (p1.py >= p2.py - 1)) {
-				/* Projectiles are at about the same height. */
+		const struct hamster *p1 = &game.p1;
+		const struct hamster *p2 = &game.p2;
 
-				if (p1.px >= p2.px) {
-					/* They must have collided. */
-					p1.px = -1;
-					p2.px = -1;
-				}
-			}
-		}
+		draw_rect(0, p1->y, 23, p1->y + 31, RED);
+		draw_rect(tft_width - 24, p2->y, tft_width - 1, p2->y + 31, GREEN);
 
 		/*
-		 * Horizontal projectile movement
+		 * Draw hearts
 		 */
 
-		float pdistance = 0.5 * (float)tft_width / fps;
+		if (layer_stale(&hearts, (p1->hp << 8) | p2->hp)) {
+			bool fits = true;
 
-		if (p1.px >= 0)
-			p1.px += pdistance;
+			for (int i = 0; i < p1->hp; i++)
+				fits &= layer_add_sprite(&hearts, &sprite_heart, 28 + 16 * i, 4, RED);
 
-		if (p2.px >= 0)
-			p2.px -= pdistance;
+			for (int i = 0; i < p2->hp; i++)
+				fits &= layer_add_sprite(&hearts, &sprite_heart,
+							 tft_width - 17 - (28 + 16 * i), 4, GREEN);
 
-		if (p1.px >= tft_width)
-			p1.px = -1;
+			if (!fits)
+				puts("hud: hearts do not fit their layer");
+		}
 
-		if (p2.px < 0)
-			p2.px = -1;
+		draw_layer(&hearts);
 
 		/*
-		 * Projectile-hamster collissions
+		 * Draw projectiles
 		 */
 
-		if (p1.px >= 0) {
-			if (p1.py >= p2.y && p1.py < (p2.y + 32)) {
-				if (p1.px >= tft_width - 24) {
-					p1.px = -1;
-					p2.hp -= 1;
-
-					if (p2.hp < 1)
-						reset_game();
-				}
-			}
-		}
-
-		if (p2.px >= 0) {
-			if (p2.py >= p1.y && p2.py < (p1.y + 32)) {
-				if (p2.px < 24) {
-					p2.px = -1;
-					p1.hp -= 1;
+		if (p1->px >= 0)
+			draw_rect(p1->px - 1, p1->py - 1, p1->px + 1, p1->py + 1, RED);
 
-					if (p1.hp < 1)
-						reset_game();
-				}
-			}
-		}
+		if (p2->px >= 0)
+			draw_rect(p2->px - 1, p2->py - 1, p2->px + 1, p2->py + 1, GREEN);
 
 		/*
 		 * FPS and others
 		 */
 
-		char buf[64];
+		if (layer_stale(&fps_layer, fps))
+			if (!layer_add_number(&fps_layer, tft_width, 1, fps, GRAY))
+				puts("hud: fps does not fit its layer");
+
+		draw_layer(&fps_layer);
 
-		snprintf(buf, sizeof buf, "%i", fps);
-		tft_draw_string_right(tft_width - 1, 0, GRAY, buf);
+		bool measure = press_is_pending;
+		uint32_t pressed_at = press_pending;
+		press_is_pending = false;
+
+		if (MIRROR)
+			mirror_submit();
 
 		tft_swap_buffers();
+		account_busy(started);
+
 		task_sleep_ms(3);
+
+		/* Waiting for the display to take the frame is idle time. */
 		tft_sync();
 
 		uint32_t this_sync = time_us_32();
-		uint32_t delta = this_sync - last_sync;
-		fps = 1 * 1000 * 1000 / delta;
-		last_sync = this_sync;
+		started = this_sync;
+		uint32_t delta = this_sync - fps_since;
+		fps_frames++;
+
+		if (delta >= FPS_PERIOD_US) {
+			fps = (uint64_t)fps_frames * 1000 * 1000 / delta;
+			fps_since = this_sync;
+			fps_frames = 0;
+		}
+
+		/*
+		 * Button-to-photon latency
+		 */
+
+		if (measure) {
+			uint32_t latency = this_sync - pressed_at;
+
+			latency_sum += latency;
+			latency_count++;
+
+			if (latency > latency_max)
+				latency_max = latency;
+		}
+
+		account_busy(started);
+
+		/*
+		 * Frame pacing
+		 */
+
+#if FRAME_CAP_HZ
+		next_frame += 1000 * 1000 / FRAME_CAP_HZ;
+
+		/* Do not try to catch up after falling behind. */
+		if (next_frame < time_us_64())
+			next_frame = time_us_64();
+		else
+			idle_until(next_frame);
+#endif
 	}
 }
 
 int main()
 {
+#if PERF_PROFILE
+	vreg_set_voltage(PERF_VREG);
+	sleep_ms(10);
+
+	/* Stay at the default clock if the PLL cannot hit the target. */
+	bool overclocked = set_sys_clock_khz(PERF_SYS_KHZ, false);
+
+	/*
+	 * Changing clk_sys moves clk_peri to the 48 MHz USB PLL, which would
+	 * leave the TFT SPI at 24 MHz at most. It has no divider, so run it
+	 * from clk_sys directly and let tft_init pick the SPI prescaler.
+	 */
+	if (overclocked)
+		clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS,
+				PERF_SYS_KHZ * 1000, PERF_SYS_KHZ * 1000);
+#endif
+
 	stdio_usb_init();
 	task_init();
 
@@ -425,34 +889,26 @@ int main()
 
 	tft_init();
 
+	sounds_init();
+	audio_init();
+
 	printf("Hello, have a nice and productive day!\n");
 
 	dap_init(DAP_SWDIO_PIN, DAP_SWCLK_PIN);
-	dap_reset();
-
-	dap_select_target(DAP_CORE0);
-	unsigned idcode = dap_read_idcode();
-	printf("idcode = %#010x\n", idcode);
-	dap_setup_mem((uint32_t *)&idcode);
-	printf("idr = %#010x\n", idcode);
-	dap_noop();
 
-	/* Un-reset stuff that's ok with clk_sys and clk_ref */
-	dap_poke(0x4000c000, 0x1e3bc9d);
-
-	/* Enable display backlight. */
-	dap_poke(0x4001406c, 0x331f);
+#if PERF_PROFILE
+	unsigned swd_hz = dap_set_clock(clock_get_hz(clk_sys), PERF_SWD_HZ);
 
-	/* Enable button input + pull-ups. */
-	dap_poke(0x4001c000 + 4 + 4 * SLAVE_A_PIN, (1 << 3) | (1 << 6));
-	dap_poke(0x4001c000 + 4 + 4 * SLAVE_B_PIN, (1 << 3) | (1 << 6));
-	dap_poke(0x4001c000 + 4 + 4 * SLAVE_X_PIN, (1 << 3) | (1 << 6));
-	dap_poke(0x4001c000 + 4 + 4 * SLAVE_Y_PIN, (1 << 3) | (1 << 6));
+	printf("perf: %s, swd = %u Hz\n", overclocked ? "overclocked" : "overclock failed",
+	       swd_hz);
+#endif
 
-	dap_poke(0x4001c000 + 4 + 4 * SLAVE_SELECT_PIN, (1 << 3) | (1 << 6));
+	printf("clk_sys = %u Hz, clk_peri = %u Hz, spi = %u Hz\n",
+	       (unsigned)clock_get_hz(clk_sys), (unsigned)clock_get_hz(clk_peri),
+	       spi_get_baudrate(TFT_SPI_DEV));
 
-	/* Make sure we do not turn outselves off. */
-	dap_poke(0x40018004, 0x001f);
+	if (!link_init(DAP_CORE0, slave_setup))
+		puts("link: slave not responding, will keep trying");
 
 	multicore_launch_core1(task_run_loop);
 	task_run_loop();
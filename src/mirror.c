@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+#include <hardware/sync.h>
+
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <task.h>
+#include <tft.h>
+
+#include <dap.h>
+#include <dap_core.h>
+
+#include "mirror.h"
+
+/*
+ * Slave display wiring, the same as ours.
+ */
+#if !defined(MIRROR_LCD_CS_PIN)
+#define MIRROR_LCD_CS_PIN 1
+#define MIRROR_LCD_SCK_PIN 2
+#define MIRROR_LCD_MOSI_PIN 3
+#define MIRROR_LCD_RS_PIN 4
+#define MIRROR_LCD_RST_PIN 6
+#endif
+
+/* Landscape, rotated by 180 degrees, BGR panel. */
+#if !defined(MIRROR_LCD_MADCTL)
+#define MIRROR_LCD_MADCTL 0xe8
+#endif
+
+/* Scan-out loop hardcodes the frame geometry. */
+static_assert(160 == MIRROR_WIDTH && 120 == MIRROR_HEIGHT, "mirror_scanout.S needs updating");
+
+/* See mirror_scanout.S */
+extern const uint8_t mirror_scanout_start[];
+extern const uint8_t mirror_scanout_end[];
+
+#define ROW_WORDS (MIRROR_WIDTH / 4)
+#define FRAME_SIZE (MIRROR_WIDTH * MIRROR_HEIGHT)
+
+#define HDR_MAGIC (MIRROR_BASE + 0)
+#define HDR_SEQ (MIRROR_BASE + 4)
+#define HDR_INDEX (MIRROR_BASE + 8)
+#define HDR_SHOWN (MIRROR_BASE + 12)
+#define BUFFER(i) (MIRROR_BASE + 16 + (i) * FRAME_SIZE)
+#define PALETTE BUFFER(2)
+#define CODE (PALETTE + 512)
+
+/*
+ * Slave peripherals used to drive its display.
+ */
+#define SLAVE_CLK_PERI_CTRL 0x40008048
+#define SLAVE_RESETS_CLR 0x4000f000
+#define SLAVE_GPIO_CTRL(pin) (0x40014004 + 8 * (pin))
+#define SLAVE_SSP 0x4003c000
+
+#define CLK_ENABLE (1 << 11)
+#define RESET_SPI0 (1 << 16)
+
+#define GPIO_FUNC_SPI 0x01
+#define GPIO_DRIVE_LOW 0x321f
+#define GPIO_DRIVE_HIGH 0x331f
+
+#define SSPCR0 0x00
+#define SSPCR1 0x04
+#define SSPDR 0x08
+#define SSPSR 0x0c
+#define SSPCPSR 0x10
+
+#define SSPCR0_8BIT 0x07
+#define SSPCR0_16BIT 0x0f
+#define SSPCR1_SSE 0x02
+#define SSPSR_BSY 0x10
+
+#define LCD_IDLE_TRIES 100
+
+/* How long to wait before bringing a failed slave display up again. */
+#define MIRROR_RETRY_US (1000 * 1000)
+
+/* ILI9341 setup after sleep out, ending with a full screen RAMWR. */
+static const struct {
+	uint8_t cmd;
+	uint8_t len;
+	uint8_t data[4];
+} lcd_setup[] = {
+	{ 0x3a, 1, { 0x55 } },
+	{ 0x36, 1, { MIRROR_LCD_MADCTL } },
+	{ 0x2a, 4, { 0, 0, 319 >> 8, 319 & 0xff } },
+	{ 0x2b, 4, { 0, 0, 239 >> 8, 239 & 0xff } },
+	{ 0x29, 0, { 0 } },
+	{ 0x2c, 0, { 0 } },
+};
+
+static uint32_t shadow[2][MIRROR_HEIGHT][ROW_WORDS];
+
+/* Shadow the rendering core draws into. */
+static uint8_t (*drawing)[MIRROR_WIDTH] = (void *)shadow[0];
+
+/* Shadow waiting to be pushed, owned by the SWD core while set. */
+static uint32_t (*volatile pending)[ROW_WORDS] = NULL;
+
+/* Rows as they are in either slave buffer. */
+static uint32_t slave_rows[2][MIRROR_HEIGHT][ROW_WORDS];
+static bool slave_valid[2];
+
+static uint32_t seq;
+
+/* Slave display is up, bumping resets invalidates an ongoing bring-up. */
+static bool ready;
+static unsigned resets;
+static uint32_t next_attempt;
+
+static bool lcd_idle(void)
+{
+	for (int i = 0; i < LCD_IDLE_TRIES; i++) {
+		uint32_t status;
+
+		if (!dap_peek(SLAVE_SSP + SSPSR, &status))
+			return false;
+
+		if (!(status & SSPSR_BSY))
+			return true;
+	}
+
+	puts("mirror: display SPI stuck");
+	return false;
+}
+
+static bool lcd_command(uint8_t cmd, const uint8_t *data, int len)
+{
+	if (!lcd_idle())
+		return false;
+
+	if (!dap_poke(SLAVE_GPIO_CTRL(MIRROR_LCD_RS_PIN), GPIO_DRIVE_LOW))
+		return false;
+
+	if (!dap_poke(SLAVE_SSP + SSPDR, cmd))
+		return false;
+
+	if (!lcd_idle())
+		return false;
+
+	if (!dap_poke(SLAVE_GPIO_CTRL(MIRROR_LCD_RS_PIN), GPIO_DRIVE_HIGH))
+		return false;
+
+	/* Few enough to fit the FIFO. */
+	for (int i = 0; i < len; i++)
+		if (!dap_poke(SLAVE_SSP + SSPDR, data[i]))
+			return false;
+
+	return true;
+}
+
+static bool lcd_ssp_mode(uint32_t cr0)
+{
+	if (!dap_poke(SLAVE_SSP + SSPCR1, 0))
+		return false;
+
+	if (!dap_poke(SLAVE_SSP + SSPCR0, cr0))
+		return false;
+
+	return dap_poke(SLAVE_SSP + SSPCR1, SSPCR1_SSE);
+}
+
+/*
+ * Reset the display and leave it expecting a stream of 16-bit pixels.
+ */
+static bool lcd_init(void)
+{
+	/* Peripheral clock from clk_sys. SPI0 is ready long before our next write. */
+	if (!dap_poke(SLAVE_CLK_PERI_CTRL, CLK_ENABLE))
+		return false;
+
+	if (!dap_poke(SLAVE_RESETS_CLR, RESET_SPI0))
+		return false;
+
+	if (!dap_poke(SLAVE_GPIO_CTRL(MIRROR_LCD_SCK_PIN), GPIO_FUNC_SPI))
+		return false;
+
+	if (!dap_poke(SLAVE_GPIO_CTRL(MIRROR_LCD_MOSI_PIN), GPIO_FUNC_SPI))
+		return false;
+
+	if (!dap_poke(SLAVE_GPIO_CTRL(MIRROR_LCD_CS_PIN), GPIO_DRIVE_LOW))
+		return false;
+
+	if (!dap_poke(SLAVE_GPIO_CTRL(MIRROR_LCD_RST_PIN), GPIO_DRIVE_LOW))
+		return false;
+
+	/* Half of clk_peri, whatever the slave clocks happen to be. */
+	if (!dap_poke(SLAVE_SSP + SSPCPSR, 2))
+		return false;
+
+	if (!lcd_ssp_mode(SSPCR0_8BIT))
+		return false;
+
+	task_sleep_ms(10);
+
+	if (!dap_poke(SLAVE_GPIO_CTRL(MIRROR_LCD_RST_PIN), GPIO_DRIVE_HIGH))
+		return false;
+
+	task_sleep_ms(120);
+
+	/* Sleep out */
+	if (!lcd_command(0x11, NULL, 0))
+		return false;
+
+	task_sleep_ms(120);
+
+	for (unsigned i = 0; i < sizeof(lcd_setup) / sizeof(*lcd_setup); i++)
+		if (!lcd_command(lcd_setup[i].cmd, lcd_setup[i].data, lcd_setup[i].len))
+			return false;
+
+	if (!lcd_idle())
+		return false;
+
+	return lcd_ssp_mode(SSPCR0_16BIT);
+}
+
+/*
+ * Copy palette and the scan-out loop into the slave memory.
+ */
+static bool mirror_upload(void)
+{
+	static uint32_t words[128];
+	unsigned size = mirror_scanout_end - mirror_scanout_start;
+
+	static_assert(sizeof(words) == 256 * sizeof(uint16_t), "palette does not fit");
+
+	for (int i = 0; i < 128; i++)
+		words[i] = tft_palette[2 * i] | ((uint32_t)tft_palette[2 * i + 1] << 16);
+
+	if (!dap_poke_many(PALETTE, words, 128))
+		return false;
+
+	if (size > sizeof(words)) {
+		puts("mirror: scan-out loop too large");
+		return false;
+	}
+
+	memcpy(words, mirror_scanout_start, size);
+	return dap_poke_many(CODE, words, (size + 3) / 4);
+}
+
+/*
+ * Point the slave core 0 at the scan-out loop.
+ */
+static bool mirror_start(void)
+{
+	uint32_t regs[DAP_CORE_NUM_REGS];
+
+	if (!dap_core_halt(NULL))
+		return false;
+
+	if (!dap_core_read_regs(regs))
+		return false;
+
+	regs[DAP_CORE_R0 + 0] = MIRROR_BASE;
+	regs[DAP_CORE_R0 + 1] = SLAVE_SSP;
+	regs[DAP_CORE_R0 + 2] = PALETTE;
+	regs[DAP_CORE_PC] = CODE;
+
+	/* Thumb state, no exception active. */
+	regs[DAP_CORE_XPSR] = 1u << 24;
+
+	if (!dap_core_write_regs(regs))
+		return false;
+
+	return dap_core_resume();
+}
+
+/*
+ * Bring up the slave display, write the header and start the scan-out
+ * loop on the slave core 0, taking it over.
+ */
+static bool mirror_init(void)
+{
+	uint32_t header[4] = { MIRROR_MAGIC, 0, 0, 0 };
+
+	seq = 0;
+	slave_valid[0] = false;
+	slave_valid[1] = false;
+
+	if (!dap_poke_many(MIRROR_BASE, header, 4)) {
+		puts("mirror: failed to write header");
+		return false;
+	}
+
+	if (!lcd_init()) {
+		puts("mirror: failed to set up the display");
+		return false;
+	}
+
+	if (!mirror_upload()) {
+		puts("mirror: failed to upload the scan-out loop");
+		return false;
+	}
+
+	if (!mirror_start()) {
+		puts("mirror: failed to start the scan-out loop");
+		return false;
+	}
+
+	return true;
+}
+
+void mirror_reset(void)
+{
+	ready = false;
+	resets++;
+	next_attempt = time_us_32();
+}
+
+void mirror_fill(int color)
+{
+	memset(drawing, color, FRAME_SIZE);
+}
+
+void mirror_rect(int x0, int y0, int x1, int y1, int color)
+{
+	if (x0 < 0)
+		x0 = 0;
+
+	if (y0 < 0)
+		y0 = 0;
+
+	if (x1 >= MIRROR_WIDTH)
+		x1 = MIRROR_WIDTH - 1;
+
+	if (y1 >= MIRROR_HEIGHT)
+		y1 = MIRROR_HEIGHT - 1;
+
+	for (int y = y0; y <= y1; y++)
+		if (x0 <= x1)
+			memset(&drawing[y][x0], color, x1 - x0 + 1);
+}
+
+void mirror_layer(const struct layer *layer)
+{
+	for (int i = 0; i < layer->len; i++) {
+		const struct layer_span *span = &layer->spans[i];
+		mirror_rect(span->x0, span->y, span->x1, span->y, span->color);
+	}
+}
+
+void mirror_submit(void)
+{
+	if (pending)
+		return;
+
+	uint32_t(*done)[ROW_WORDS] = (void *)drawing;
+	drawing = (void *)(done == shadow[0] ? shadow[1] : shadow[0]);
+
+	/* Make sure the frame is complete before handing it over. */
+	__dmb();
+	pending = done;
+}
+
+enum mirror_result mirror_push(void)
+{
+	uint32_t(*frame)[ROW_WORDS] = pending;
+
+	if (!frame)
+		return MIRROR_IDLE;
+
+	__dmb();
+
+	if (!ready) {
+		if ((int32_t)(time_us_32() - next_attempt) < 0) {
+			pending = NULL;
+			return MIRROR_DOWN;
+		}
+
+		unsigned started = resets;
+
+		if (!mirror_init()) {
+			next_attempt = time_us_32() + MIRROR_RETRY_US;
+			goto fail;
+		}
+
+		/* The slave has been reset meanwhile, start over. */
+		if (started != resets) {
+			pending = NULL;
+			return MIRROR_DOWN;
+		}
+
+		ready = true;
+	}
+
+	uint32_t shown;
+
+	if (!dap_peek(HDR_SHOWN, &shown))
+		goto fail;
+
+	/* The other buffer is still on the slave's screen. */
+	if (shown != seq) {
+		pending = NULL;
+		return MIRROR_BUSY;
+	}
+
+	int index = (seq + 1) & 1;
+	uint32_t(*rows)[ROW_WORDS] = slave_rows[index];
+	bool valid = slave_valid[index];
+
+	/* Push runs of consecutive changed rows as single block writes. */
+	for (int y = 0; y < MIRROR_HEIGHT;) {
+		if (valid && !memcmp(rows[y], frame[y], sizeof(rows[y]))) {
+			y++;
+			continue;
+		}
+
+		int start = y;
+
+		do {
+			y++;
+		} while (y < MIRROR_HEIGHT && (!valid || memcmp(rows[y], frame[y], sizeof(rows[y]))));
+
+		uint32_t addr = BUFFER(index) + start * MIRROR_WIDTH;
+		int len = (y - start) * ROW_WORDS;
+
+		if (!dap_poke_many(addr, frame[start], len)) {
+			slave_valid[index] = false;
+			goto fail;
+		}
+
+		memcpy(rows[start], frame[start], len * sizeof(uint32_t));
+	}
+
+	slave_valid[index] = true;
+
+	/* Publish the buffer index before the sequence number. */
+	if (!dap_poke(HDR_INDEX, index))
+		goto fail;
+
+	if (!dap_poke(HDR_SEQ, seq + 1))
+		goto fail;
+
+	seq++;
+	pending = NULL;
+	return MIRROR_PUSHED;
+
+fail:
+	pending = NULL;
+	return MIRROR_FAILED;
+}
@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <input.h>
+#include <net.h>
+#include <ring.h>
+
+/*
+ * How many ticks can we run ahead of the remote player.
+ * Every one of them costs a game snapshot. Must be a power of two.
+ */
+#if !defined(NET_WINDOW)
+#define NET_WINDOW 32
+#endif
+
+/*
+ * Local input is applied this many ticks later, giving it time to
+ * reach the other side before it is needed there.
+ */
+#if !defined(NET_DELAY)
+#define NET_DELAY 2
+#endif
+
+/*
+ * Size of the queues between the cores. Must be a power of two.
+ */
+#if !defined(NET_QUEUE_SIZE)
+#define NET_QUEUE_SIZE 128
+#endif
+
+/*
+ * How often to offer a session while waiting for the remote player.
+ */
+#define NET_SYNC_PERIOD_US (100 * 1000)
+
+static_assert(0 == (NET_WINDOW & (NET_WINDOW - 1)), "NET_WINDOW must be a power of two");
+static_assert(0 == (NET_QUEUE_SIZE & (NET_QUEUE_SIZE - 1)),
+	      "NET_QUEUE_SIZE must be a power of two");
+
+/*
+ * Remote side can be up to NET_WINDOW + NET_DELAY ticks ahead of us and
+ * we keep NET_WINDOW ticks of history, input ring must cover them all.
+ */
+#define NET_INPUTS (4 * NET_WINDOW)
+
+static_assert(NET_INPUTS > 2 * (NET_WINDOW + NET_DELAY), "NET_DELAY too large");
+
+/* Buttons of a single player, as sent over the wire. */
+#define NET_BUTTONS ((1u << INPUT_P1_UP) | (1u << INPUT_P1_GUN))
+
+enum net_msg_kind {
+	NET_MSG_START = 0,
+	NET_MSG_STOP,
+	NET_MSG_SYNC,
+	NET_MSG_INPUT,
+	NET_MSG_NOTE,
+};
+
+/* Status lines for the console, the player number goes in the tick. */
+enum net_note {
+	NET_NOTE_WAITING = 0,
+	NET_NOTE_SAME_PLAYER,
+	NET_NOTE_PLAYING,
+	NET_NOTE_STOPPED,
+};
+
+struct net_msg {
+	uint32_t tick;
+	uint8_t kind;
+	uint8_t bits;
+};
+
+struct net_queue {
+	struct net_msg msgs[NET_QUEUE_SIZE];
+	struct ring ring;
+};
+
+/* From the console core to the game core and back. */
+static struct net_queue inbox;
+static struct net_queue outbox;
+
+enum net_state {
+	NET_OFF = 0,
+	NET_WAITING,
+	NET_PLAYING,
+};
+
+/*
+ * Session state, owned by the game core.
+ */
+static volatile enum net_state state;
+static int me;
+
+/* Our sync answer still has to go out, before any input. */
+static bool sync_due;
+static uint32_t sync_sent;
+
+/* Next tick to simulate. */
+static uint32_t tick;
+
+/* Remote input is known for all ticks before this one. */
+static uint32_t confirmed;
+
+/* Used to predict remote input past the confirmed tick. */
+static uint8_t remote_last;
+
+/* Game state right before the given tick, for the last NET_WINDOW ticks. */
+static struct game snapshots[NET_WINDOW];
+
+/* Buttons of both players, indexed by tick. */
+static uint8_t inputs[2][NET_INPUTS];
+
+/* Statistics, reset by the reporter. */
+static volatile unsigned rollbacks;
+static volatile unsigned deepest;
+static volatile unsigned stalls;
+
+static bool net_push(struct net_queue *queue, uint8_t kind, uint32_t tick, uint8_t bits)
+{
+	int slot = ring_claim(&queue->ring, NET_QUEUE_SIZE);
+
+	if (slot < 0)
+		return false;
+
+	struct net_msg *msg = &queue->msgs[slot];
+	msg->tick = tick;
+	msg->kind = kind;
+	msg->bits = bits;
+
+	ring_publish(&queue->ring);
+	return true;
+}
+
+static bool net_pop(struct net_queue *queue, struct net_msg *msg)
+{
+	int slot = ring_peek(&queue->ring, NET_QUEUE_SIZE);
+
+	if (slot < 0)
+		return false;
+
+	*msg = queue->msgs[slot];
+	ring_release(&queue->ring);
+
+	return true;
+}
+
+bool net_start(int player)
+{
+	return net_push(&inbox, NET_MSG_START, 0, !!player);
+}
+
+bool net_stop(void)
+{
+	return net_push(&inbox, NET_MSG_STOP, 0, 0);
+}
+
+bool net_receive_sync(int player)
+{
+	return net_push(&inbox, NET_MSG_SYNC, 0, !!player);
+}
+
+bool net_receive(uint32_t tick, uint8_t bits)
+{
+	return net_push(&inbox, NET_MSG_INPUT, tick, bits & NET_BUTTONS);
+}
+
+bool net_active(void)
+{
+	return NET_OFF != state;
+}
+
+bool net_output(char *line, int size)
+{
+	struct net_msg msg;
+
+	if (!net_pop(&outbox, &msg))
+		return false;
+
+	unsigned player = msg.tick + 1;
+
+	if (NET_MSG_SYNC == msg.kind)
+		snprintf(line, size, "sync %u", msg.bits + 1);
+	else if (NET_MSG_INPUT == msg.kind)
+		snprintf(line, size, "input %u %u", (unsigned)msg.tick, msg.bits);
+	else if (NET_NOTE_WAITING == msg.bits)
+		snprintf(line, size, "net: waiting for player %u", player);
+	else if (NET_NOTE_SAME_PLAYER == msg.bits)
+		snprintf(line, size, "net: both sides play as %u", player);
+	else if (NET_NOTE_PLAYING == msg.bits)
+		snprintf(line, size, "net: playing as %u", player);
+	else
+		snprintf(line, size, "net: stopped");
+
+	return true;
+}
+
+/*
+ * Have the console print a status line, the game core must not block
+ * on stdio. Notes are dropped rather than waited for.
+ */
+static void net_note(enum net_note note, int player)
+{
+	net_push(&outbox, NET_MSG_NOTE, player, note);
+}
+
+static uint32_t net_buttons(uint32_t t)
+{
+	unsigned i = t & (NET_INPUTS - 1);
+
+	/* Remote input we do not have yet is the same as the last one. */
+	if (t >= confirmed)
+		inputs[!me][i] = remote_last;
+
+	return inputs[0][i] | (inputs[1][i] << INPUT_P2_UP);
+}
+
+static void net_begin(struct game *game, int player)
+{
+	game_reset(game);
+
+	/* Nobody has pressed anything during the initial delay. */
+	memset(inputs, 0, sizeof(inputs));
+
+	state = NET_WAITING;
+	me = player;
+	tick = 0;
+	confirmed = NET_DELAY;
+	remote_last = 0;
+
+	/* Offer the session right away. */
+	sync_due = true;
+
+	net_note(NET_NOTE_WAITING, !player);
+}
+
+/*
+ * Restore the snapshot right before the given tick and re-run the rest.
+ */
+static void net_rollback(struct game *game, uint32_t from)
+{
+	unsigned depth = tick - from;
+
+	*game = snapshots[from & (NET_WINDOW - 1)];
+
+	for (uint32_t t = from; t < tick; t++) {
+		snapshots[t & (NET_WINDOW - 1)] = *game;
+		game_step(game, net_buttons(t), false);
+	}
+
+	rollbacks++;
+
+	if (depth > deepest)
+		deepest = depth;
+}
+
+/*
+ * Both sides keep offering the session until they hear from the other one
+ * and then answer once more. The answer goes out before our first input,
+ * so the other side never receives input before it starts playing.
+ */
+static void net_sync(int player)
+{
+	if (NET_WAITING != state)
+		return;
+
+	if (player == me) {
+		net_note(NET_NOTE_SAME_PLAYER, me);
+		return;
+	}
+
+	state = NET_PLAYING;
+	sync_due = true;
+
+	net_note(NET_NOTE_PLAYING, me);
+}
+
+static void net_poll(struct game *game)
+{
+	uint32_t rollback = tick;
+	struct net_msg msg;
+
+	while (net_pop(&inbox, &msg)) {
+		if (NET_MSG_START == msg.kind) {
+			net_begin(game, msg.bits);
+			rollback = tick;
+			continue;
+		}
+
+		if (NET_MSG_STOP == msg.kind) {
+			if (NET_OFF != state)
+				net_note(NET_NOTE_STOPPED, 0);
+
+			state = NET_OFF;
+			continue;
+		}
+
+		if (NET_MSG_SYNC == msg.kind) {
+			net_sync(msg.bits);
+			continue;
+		}
+
+		if (NET_PLAYING != state)
+			continue;
+
+		/* Serial link is reliable, anything else is a stale message. */
+		if (msg.tick != confirmed)
+			continue;
+
+		uint8_t *slot = &inputs[!me][msg.tick & (NET_INPUTS - 1)];
+
+		if (msg.tick < tick && *slot != msg.bits && msg.tick < rollback)
+			rollback = msg.tick;
+
+		*slot = msg.bits;
+		remote_last = msg.bits;
+		confirmed++;
+	}
+
+	if (rollback < tick)
+		net_rollback(game, rollback);
+}
+
+/*
+ * Send our sync when due, returns false when the outbox is full.
+ */
+static bool net_send_sync(void)
+{
+	uint32_t now = time_us_32();
+
+	if (NET_WAITING == state && now - sync_sent >= NET_SYNC_PERIOD_US)
+		sync_due = true;
+
+	if (!sync_due)
+		return true;
+
+	if (!net_push(&outbox, NET_MSG_SYNC, 0, me))
+		return false;
+
+	sync_due = false;
+	sync_sent = now;
+	return true;
+}
+
+bool net_tick(struct game *game, uint32_t buttons)
+{
+	net_poll(game);
+
+	if (NET_OFF == state) {
+		game_step(game, buttons, true);
+		return true;
+	}
+
+	if (!net_send_sync() || NET_WAITING == state)
+		return false;
+
+	/* Snapshot of the oldest unconfirmed tick would be overwritten. */
+	if ((int32_t)(tick - confirmed) >= NET_WINDOW) {
+		stalls++;
+		return false;
+	}
+
+	/* Either pair of buttons controls our hamster. */
+	uint8_t local = (buttons | (buttons >> INPUT_P2_UP)) & NET_BUTTONS;
+	uint32_t at = tick + NET_DELAY;
+
+	/* Input that never leaves would desynchronise us. */
+	if (!net_push(&outbox, NET_MSG_INPUT, at, local)) {
+		stalls++;
+		return false;
+	}
+
+	inputs[me][at & (NET_INPUTS - 1)] = local;
+
+	snapshots[tick & (NET_WINDOW - 1)] = *game;
+	game_step(game, net_buttons(tick), true);
+	tick++;
+
+	return true;
+}
+
+void net_stats_report_reset(void)
+{
+	if (NET_PLAYING != state)
+		return;
+
+	printf("net: tick %u, %i ahead, %u rollbacks up to %u ticks, %u stalls\n",
+	       (unsigned)tick, (int)(tick - confirmed), rollbacks, deepest, stalls);
+
+	rollbacks = 0;
+	deepest = 0;
+	stalls = 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include "audio.h"
+#include "sounds.h"
+
+#define JUMP_LEN (AUDIO_RATE / 8)
+#define SHOT_LEN (AUDIO_RATE / 16)
+#define HIT_LEN (AUDIO_RATE / 5)
+
+int8_t sound_jump[JUMP_LEN];
+int8_t sound_shot[SHOT_LEN];
+int8_t sound_hit[HIT_LEN];
+
+const int sound_jump_len = JUMP_LEN;
+const int sound_shot_len = SHOT_LEN;
+const int sound_hit_len = HIT_LEN;
+
+/*
+ * Square wave sweeping from one frequency to another, fading out.
+ */
+static void sweep(int8_t *out, int len, int from_hz, int to_hz)
+{
+	uint32_t phase = 0;
+
+	for (int i = 0; i < len; i++) {
+		int hz = from_hz + (to_hz - from_hz) * i / len;
+		phase += (uint32_t)((uint64_t)hz * (1ull << 32) / AUDIO_RATE);
+
+		int amp = 100 * (len - i) / len;
+		out[i] = (phase >> 31) ? amp : -amp;
+	}
+}
+
+/*
+ * Fading white noise.
+ */
+static void noise(int8_t *out, int len)
+{
+	uint32_t lfsr = 0xace1u;
+
+	for (int i = 0; i < len; i++) {
+		lfsr ^= lfsr << 13;
+		lfsr ^= lfsr >> 17;
+		lfsr ^= lfsr << 5;
+
+		int amp = 100 * (len - i) / len;
+		out[i] = (int)(lfsr & 0xff) * amp / 255 - amp / 2;
+	}
+}
+
+void sounds_init(void)
+{
+	sweep(sound_jump, JUMP_LEN, 300, 900);
+	noise(sound_shot, SHOT_LEN);
+	sweep(sound_hit, HIT_LEN, 160, 40);
+}
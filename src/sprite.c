@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <tft.h>
+
+#include "sprite.h"
+
+static bool sprite_bitmap_spans(const struct sprite *sprite, int x, int y, int color,
+				sprite_span_fn fn, void *arg)
+{
+	int stride = (sprite->w + 7) / 8;
+
+	for (int row = 0; row < sprite->h; row++) {
+		const uint8_t *bits = sprite->data + row * stride;
+		int start = -1;
+
+		for (int col = 0; col <= sprite->w; col++) {
+			bool visible = col < sprite->w && ((bits[col >> 3] << (col & 7)) & 0x80);
+
+			if (visible && start < 0) {
+				start = col;
+			} else if (!visible && start >= 0) {
+				if (!fn(arg, y + row, x + start, x + col - 1, color))
+					return false;
+
+				start = -1;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool sprite_rle_spans(const struct sprite *sprite, int x, int y, int color,
+			     sprite_span_fn fn, void *arg)
+{
+	const uint8_t *data = sprite->data;
+	bool indexed = sprite->flags & SPRITE_INDEXED;
+
+	for (int row = 0; row < sprite->h; row++) {
+		int runs = *data++;
+
+		while (runs--) {
+			int start = *data++;
+			int len = *data++;
+			int c = indexed ? *data++ : color;
+
+			if (!fn(arg, y + row, x + start, x + start + len - 1, c))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool sprite_spans(const struct sprite *sprite, int x, int y, int color, sprite_span_fn fn,
+		  void *arg)
+{
+	x += sprite->x;
+	y += sprite->y;
+
+	if (sprite->flags & SPRITE_RLE)
+		return sprite_rle_spans(sprite, x, y, color, fn, arg);
+
+	return sprite_bitmap_spans(sprite, x, y, color, fn, arg);
+}
+
+static bool sprite_draw_span(void *arg, int y, int x0, int x1, int color)
+{
+	(void)arg;
+	tft_draw_rect(x0, y, x1, y, color);
+	return true;
+}
+
+void sprite_draw(const struct sprite *sprite, int x, int y, int color)
+{
+	sprite_spans(sprite, x, y, color, sprite_draw_span, NULL);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+#include <task.h>
+
+#include "swd_target.h"
+
+static uint32_t gpio_out;
+static uint32_t gpio_oe;
+
+static uint32_t time_us;
+
+void gpio_init(uint gpio)
+{
+	gpio_oe &= ~(1u << gpio);
+	gpio_out &= ~(1u << gpio);
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down)
+{
+	/* All lines are pulled up by the targets. */
+	(void)gpio;
+	(void)up;
+	(void)down;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+	gpio_set_dir_masked(1u << gpio, (uint32_t)out << gpio);
+}
+
+void gpio_set_dir_masked(uint32_t mask, uint32_t value)
+{
+	gpio_oe = (gpio_oe & ~mask) | (value & mask);
+}
+
+void gpio_put(uint gpio, bool value)
+{
+	gpio_put_masked(1u << gpio, (uint32_t)value << gpio);
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value)
+{
+	uint32_t rising = ~gpio_out & value & mask & gpio_oe;
+
+	gpio_out = (gpio_out & ~mask) | (value & mask);
+
+	if (rising)
+		swd_target_clock(rising, gpio_out, gpio_oe);
+}
+
+bool gpio_get(uint gpio)
+{
+	return (gpio_get_all() >> gpio) & 1;
+}
+
+uint32_t gpio_get_all(void)
+{
+	return (gpio_out & gpio_oe) | (swd_target_lines() & ~gpio_oe);
+}
+
+uint32_t time_us_32(void)
+{
+	return time_us;
+}
+
+void task_sleep_ms(uint32_t ms)
+{
+	time_us += 1000 * ms;
+}
+
+void task_yield(void)
+{
+}
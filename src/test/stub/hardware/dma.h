@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <pico/stdlib.h>
+
+/*
+ * Channels are handed out but never run.
+ */
+
+enum dma_channel_transfer_size {
+	DMA_SIZE_8 = 0,
+	DMA_SIZE_16 = 1,
+	DMA_SIZE_32 = 2,
+};
+
+typedef struct {
+	uint32_t ctrl;
+} dma_channel_config;
+
+static inline int dma_claim_unused_channel(bool)
+{
+	static int next;
+	return next++;
+}
+
+static inline dma_channel_config dma_channel_get_default_config(uint)
+{
+	return (dma_channel_config){ 0 };
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *,
+							 enum dma_channel_transfer_size)
+{
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *, bool)
+{
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *, bool)
+{
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *, uint)
+{
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config *, uint)
+{
+}
+
+static inline void dma_channel_configure(uint, const dma_channel_config *, volatile void *,
+					 const volatile void *, uint, bool)
+{
+}
+
+static inline void dma_channel_set_irq1_enabled(uint, bool)
+{
+}
+
+static inline bool dma_channel_get_irq1_status(uint)
+{
+	return false;
+}
+
+static inline void dma_channel_acknowledge_irq1(uint)
+{
+}
+
+static inline void dma_channel_set_read_addr(uint, const volatile void *, bool)
+{
+}
+
+static inline void dma_channel_start(uint)
+{
+}
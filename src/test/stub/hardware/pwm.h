@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <pico/stdlib.h>
+
+typedef struct {
+	uint32_t csr, div, top;
+} pwm_config;
+
+typedef struct {
+	struct {
+		uint32_t csr, div, ctr, cc, top;
+	} slice[8];
+} pwm_hw_t;
+
+static pwm_hw_t pwm_hw_stub;
+#define pwm_hw (&pwm_hw_stub)
+
+static inline uint pwm_gpio_to_slice_num(uint gpio)
+{
+	return (gpio >> 1) & 7;
+}
+
+static inline pwm_config pwm_get_default_config(void)
+{
+	return (pwm_config){ 0 };
+}
+
+static inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap)
+{
+	c->top = wrap;
+}
+
+static inline void pwm_config_set_clkdiv(pwm_config *c, float div)
+{
+	c->div = div * 16;
+}
+
+static inline void pwm_init(uint, pwm_config *, bool)
+{
+}
+
+static inline uint pwm_get_dreq(uint slice_num)
+{
+	return 24 + slice_num;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Just enough of the pico SDK to build the hardware independent parts
+ * of the firmware on the host. GPIO is backed by the SWD target model,
+ * see stub.c and swd_target.h.
+ */
+
+typedef unsigned int uint;
+
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+enum gpio_function {
+	GPIO_FUNC_PWM = 4,
+};
+
+static inline void gpio_set_function(uint, enum gpio_function)
+{
+}
+
+void gpio_init(uint gpio);
+void gpio_set_pulls(uint gpio, bool up, bool down);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_set_dir_masked(uint32_t mask, uint32_t value);
+void gpio_put(uint gpio, bool value);
+void gpio_put_masked(uint32_t mask, uint32_t value);
+bool gpio_get(uint gpio);
+uint32_t gpio_get_all(void);
+
+/*
+ * Simulated time only advances while sleeping.
+ */
+uint32_t time_us_32(void);
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "swd_target.h"
+
+enum {
+	ACK_NONE = 0,
+	ACK_OK = 1,
+	ACK_WAIT = 2,
+	ACK_FAULT = 4,
+};
+
+enum {
+	STATE_LOCKOUT = 0,
+	STATE_IDLE,
+	STATE_REQUEST,
+	STATE_TURN_ACK,
+	STATE_ACK,
+	STATE_RDATA,
+	STATE_TURN_DATA,
+	STATE_WDATA,
+};
+
+/* Request fields. */
+#define REQ_APnDP(req) (((req) >> 1) & 1)
+#define REQ_RnW(req) (((req) >> 2) & 1)
+#define REQ_ADDR(req) (((req) >> 1) & 0xc)
+
+static struct swd_target *targets[SWD_TARGET_MAX];
+static int num_targets;
+
+void swd_target_attach(struct swd_target *target, int swclk, int swdio, uint32_t targetsel)
+{
+	memset(target, 0, sizeof(*target));
+
+	target->swclk = swclk;
+	target->swdio = swdio;
+	target->targetsel = targetsel;
+	target->state = STATE_LOCKOUT;
+
+	if (num_targets < SWD_TARGET_MAX)
+		targets[num_targets++] = target;
+}
+
+void swd_target_detach_all(void)
+{
+	num_targets = 0;
+}
+
+static inline int parity(uint32_t value)
+{
+	return __builtin_popcount(value) & 1;
+}
+
+static uint32_t *target_word(struct swd_target *target, uint32_t addr)
+{
+	static uint32_t nowhere;
+
+	if (addr < SWD_TARGET_BASE || addr >= SWD_TARGET_BASE + 4 * SWD_TARGET_WORDS) {
+		nowhere = 0;
+		return &nowhere;
+	}
+
+	return &target->mem[(addr - SWD_TARGET_BASE) / 4];
+}
+
+static void tar_increment(struct swd_target *target)
+{
+	target->tar = (target->tar & ~0x3ffu) | ((target->tar + 4) & 0x3ffu);
+}
+
+static uint32_t target_read(struct swd_target *target, int ap, int addr)
+{
+	if (!ap) {
+		if (0x0 == addr)
+			return SWD_TARGET_DPIDR;
+
+		if (0x4 == addr)
+			return 0xf0000000 | target->sticky;
+
+		if (0xc == addr)
+			return target->rdbuff;
+
+		return 0;
+	}
+
+	/* AP reads are posted, they return the previous result. */
+	uint32_t value = target->rdbuff;
+
+	if (0xf0 == (target->select & 0xf0)) {
+		target->rdbuff = 0xc == addr ? SWD_TARGET_APIDR : 0;
+	} else if (0xc == addr) {
+		target->rdbuff = *target_word(target, target->tar);
+		tar_increment(target);
+	} else if (0x4 == addr) {
+		target->rdbuff = target->tar;
+	} else {
+		target->rdbuff = 0x80000052;
+	}
+
+	return value;
+}
+
+static void target_write(struct swd_target *target, int ap, int addr, uint32_t value)
+{
+	if (!ap) {
+		if (0x0 == addr) {
+			/* ABORT */
+			if (value & 0x04)
+				target->sticky &= ~SWD_STICKYERR;
+
+			if (value & 0x08)
+				target->sticky &= ~SWD_WDATAERR;
+		} else if (0x8 == addr) {
+			target->select = value;
+		}
+
+		return;
+	}
+
+	if (0x4 == addr) {
+		target->tar = value;
+	} else if (0xc == addr) {
+		*target_word(target, target->tar) = value;
+		tar_increment(target);
+	}
+}
+
+static int target_ack(struct swd_target *target, uint8_t req)
+{
+	/* DPIDR, ABORT and CTRL/STAT reads always go through. */
+	bool exempt = !REQ_APnDP(req) && (0x0 == REQ_ADDR(req) || (0x4 == REQ_ADDR(req) && REQ_RnW(req)));
+
+	if (exempt) {
+		target->oks++;
+		return ACK_OK;
+	}
+
+	if (target->sticky) {
+		target->faults++;
+		return ACK_FAULT;
+	}
+
+	if (target->wait) {
+		target->wait--;
+		target->waits++;
+		return ACK_WAIT;
+	}
+
+	target->oks++;
+	return ACK_OK;
+}
+
+static void target_request(struct swd_target *target)
+{
+	uint8_t req = target->req;
+
+	bool valid = (req & 0xc1) == 0x81 && ((req >> 5) & 1) == parity((req >> 1) & 0xf);
+
+	if (!valid) {
+		target->state = STATE_IDLE;
+		return;
+	}
+
+	bool targetsel = !REQ_APnDP(req) && !REQ_RnW(req) && 0xc == REQ_ADDR(req);
+
+	if (!targetsel && !target->selected) {
+		target->state = STATE_LOCKOUT;
+		return;
+	}
+
+	target->ack = targetsel ? ACK_NONE : target_ack(target, req);
+	target->state = STATE_TURN_ACK;
+}
+
+static void target_edge(struct swd_target *target, bool host, bool value)
+{
+	if (host && target->driving)
+		target->contention++;
+
+	/* Nobody driving the line reads as one thanks to the pull-up. */
+	if (!host)
+		value = target->driving ? target->out : 1;
+
+	/* Line reset is at least 50 ones, the target then needs TARGETSEL. */
+	if (!target->driving && value) {
+		if (++target->ones >= 50) {
+			target->state = STATE_IDLE;
+			target->selected = false;
+			return;
+		}
+	} else if (!target->driving) {
+		target->ones = 0;
+	}
+
+	switch (target->state) {
+	case STATE_LOCKOUT:
+		break;
+
+	case STATE_IDLE:
+		if (value) {
+			target->req = 1;
+			target->bit = 1;
+			target->state = STATE_REQUEST;
+		}
+		break;
+
+	case STATE_REQUEST:
+		target->req |= value << target->bit;
+
+		if (8 == ++target->bit)
+			target_request(target);
+		break;
+
+	case STATE_TURN_ACK:
+		target->bit = 0;
+		target->state = STATE_ACK;
+
+		if (ACK_NONE != target->ack) {
+			target->driving = true;
+			target->out = target->ack & 1;
+		}
+		break;
+
+	case STATE_ACK:
+		if (++target->bit < 3) {
+			target->out = (target->ack >> target->bit) & 1;
+			break;
+		}
+
+		if (ACK_OK == target->ack && REQ_RnW(target->req)) {
+			uint32_t data = target_read(target, REQ_APnDP(target->req),
+						    REQ_ADDR(target->req));
+			target->shift = data | ((uint64_t)parity(data) << 32);
+			target->bit = 0;
+			target->out = data & 1;
+			target->state = STATE_RDATA;
+			break;
+		}
+
+		target->driving = false;
+		target->state = STATE_TURN_DATA;
+		break;
+
+	case STATE_RDATA:
+		if (++target->bit < 33) {
+			target->out = (target->shift >> target->bit) & 1;
+			break;
+		}
+
+		/* Host turns the line around with the next edge. */
+		target->driving = false;
+		target->state = STATE_TURN_DATA;
+		break;
+
+	case STATE_TURN_DATA:
+		/* Data follow OK and TARGETSEL writes only. */
+		if (!REQ_RnW(target->req) && (ACK_OK == target->ack || ACK_NONE == target->ack)) {
+			target->bit = 0;
+			target->shift = 0;
+			target->state = STATE_WDATA;
+		} else {
+			target->state = STATE_IDLE;
+		}
+		break;
+
+	case STATE_WDATA:
+		target->shift |= (uint64_t)value << target->bit;
+
+		if (33 == ++target->bit) {
+			uint32_t data = target->shift;
+			bool ok = parity(data) == (int)(target->shift >> 32);
+
+			if (ACK_NONE == target->ack)
+				target->selected = ok && data == target->targetsel;
+			else if (!ok)
+				target->sticky |= SWD_WDATAERR;
+			else
+				target_write(target, REQ_APnDP(target->req), REQ_ADDR(target->req), data);
+
+			target->state = STATE_IDLE;
+		}
+		break;
+	}
+}
+
+void swd_target_clock(uint32_t rising, uint32_t out, uint32_t oe)
+{
+	for (int i = 0; i < num_targets; i++) {
+		struct swd_target *target = targets[i];
+
+		if (!(rising & (1u << target->swclk)))
+			continue;
+
+		bool host = (oe >> target->swdio) & 1;
+		bool value = (out >> target->swdio) & 1;
+
+		target_edge(target, host, value);
+	}
+}
+
+uint32_t swd_target_lines(void)
+{
+	uint32_t lines = 0xffffffff;
+
+	for (int i = 0; i < num_targets; i++)
+		if (targets[i]->driving && !targets[i]->out)
+			lines &= ~(1u << targets[i]->swdio);
+
+	return lines;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bit level model of a multidrop SW-DP with a MEM-AP in front of a small
+ * memory window, wired to the stub GPIO pins.
+ *
+ * The model samples SWDIO on rising SWCLK edges like a real target and
+ * drives its own bits right after them. It understands line reset,
+ * TARGETSEL, ABORT, SELECT, CTRL/STAT sticky flags, RDBUFF, posted AP
+ * reads and TAR auto-increment wrapping at 1 KiB.
+ *
+ * Every target has its own SWDIO pin, several of them may share SWCLK.
+ */
+
+#define SWD_TARGET_MAX 16
+
+#define SWD_TARGET_BASE 0x20040000
+#define SWD_TARGET_WORDS 1024
+
+#define SWD_TARGET_DPIDR 0x0bc12477
+#define SWD_TARGET_APIDR 0x04770031
+
+/* CTRL/STAT sticky flags. */
+#define SWD_STICKYERR 0x20
+#define SWD_WDATAERR 0x80
+
+struct swd_target {
+	int swclk;
+	int swdio;
+	uint32_t targetsel;
+
+	/* Answer WAIT to this many of the next requests. */
+	unsigned wait;
+
+	/* Answers FAULT while any is set, cleared through ABORT. */
+	uint32_t sticky;
+
+	uint32_t mem[SWD_TARGET_WORDS];
+
+	/* Requests answered by each ACK. */
+	unsigned oks, waits, faults;
+
+	/* Cycles where both sides drove SWDIO, must stay zero. */
+	unsigned contention;
+
+	/* Private state. */
+	int state;
+	int bit;
+	int ones;
+	bool selected;
+	bool driving;
+	bool out;
+	uint8_t req;
+	uint8_t ack;
+	uint64_t shift;
+	uint32_t select;
+	uint32_t tar;
+	uint32_t rdbuff;
+};
+
+/*
+ * Reset the target and connect it to given pins.
+ *
+ * The target starts locked out, waiting for a line reset.
+ */
+void swd_target_attach(struct swd_target *target, int swclk, int swdio, uint32_t targetsel);
+
+/*
+ * Disconnect all targets.
+ */
+void swd_target_detach_all(void);
+
+/*
+ * Let targets clocked by the rising pins sample the host pins.
+ */
+void swd_target_clock(uint32_t rising, uint32_t out, uint32_t oe);
+
+/*
+ * Return state of all pins as driven by the targets.
+ *
+ * Lines nobody drives are pulled up.
+ */
+uint32_t swd_target_lines(void);
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdio.h>
+
+/*
+ * Minimal checks for the host tests. Every test program returns
+ * non-zero when any of its checks failed.
+ */
+
+static unsigned test_failures;
+
+static inline void test_check(bool ok, const char *file, int line, const char *what)
+{
+	if (ok)
+		return;
+
+	printf("%s:%i: check failed: %s\n", file, line, what);
+	test_failures++;
+}
+
+#define CHECK(cond) test_check((cond), __FILE__, __LINE__, #cond)
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include <audio.h>
+
+#include "test.h"
+
+#define SILENCE 128
+
+static uint16_t out[AUDIO_BLOCK];
+
+static int8_t samples[AUDIO_CHANNELS + 1][4 * AUDIO_BLOCK];
+
+static void fill(int8_t *data, int8_t value)
+{
+	for (int i = 0; i < 4 * AUDIO_BLOCK; i++)
+		data[i] = value;
+}
+
+/*
+ * Mix until all voices have finished.
+ */
+static void drain(void)
+{
+	for (int i = 0; i < 64; i++)
+		audio_mix(out, AUDIO_BLOCK);
+}
+
+static bool block_is(int from, int to, int value)
+{
+	for (int i = from; i < to; i++)
+		if (out[i] != value)
+			return false;
+
+	return true;
+}
+
+static void test_clipping(void)
+{
+	fill(samples[0], 127);
+	fill(samples[1], 127);
+	CHECK(audio_play(samples[0], AUDIO_BLOCK, 256));
+	CHECK(audio_play(samples[1], AUDIO_BLOCK, 256));
+
+	audio_mix(out, AUDIO_BLOCK);
+	CHECK(block_is(0, AUDIO_BLOCK, 255));
+
+	fill(samples[2], -128);
+	fill(samples[3], -128);
+	CHECK(audio_play(samples[2], AUDIO_BLOCK, 256));
+	CHECK(audio_play(samples[3], AUDIO_BLOCK, 256));
+
+	audio_mix(out, AUDIO_BLOCK);
+	CHECK(block_is(0, AUDIO_BLOCK, 0));
+
+	/* Volume scales before the sum is clipped. */
+	CHECK(audio_play(samples[0], AUDIO_BLOCK, 128));
+	CHECK(audio_play(samples[1], AUDIO_BLOCK, 64));
+
+	audio_mix(out, AUDIO_BLOCK);
+	CHECK(block_is(0, AUDIO_BLOCK, SILENCE + 63 + 31));
+
+	drain();
+}
+
+static void test_stealing(void)
+{
+	/* Distinct bits tell which voices are playing. */
+	for (int v = 0; v <= AUDIO_CHANNELS; v++) {
+		fill(samples[v], 1 << v);
+		CHECK(audio_play(samples[v], (4 - (v & 3)) * AUDIO_BLOCK, 256));
+	}
+
+	/* The shortest voice made room for the last one. */
+	audio_mix(out, AUDIO_BLOCK);
+	CHECK(block_is(0, AUDIO_BLOCK, SILENCE + 0x1f - (1 << 3)));
+
+	drain();
+}
+
+static void test_end_mid_block(void)
+{
+	fill(samples[0], 10);
+	CHECK(audio_play(samples[0], 100, 256));
+
+	audio_mix(out, AUDIO_BLOCK);
+	CHECK(block_is(0, 100, SILENCE + 10));
+	CHECK(block_is(100, AUDIO_BLOCK, SILENCE));
+
+	/* Nothing left over for the next block. */
+	audio_mix(out, AUDIO_BLOCK);
+	CHECK(block_is(0, AUDIO_BLOCK, SILENCE));
+
+	/* Ending exactly at a short block boundary. */
+	CHECK(audio_play(samples[0], 100, 256));
+
+	audio_mix(out, 100);
+	CHECK(block_is(0, 100, SILENCE + 10));
+
+	audio_mix(out, AUDIO_BLOCK);
+	CHECK(block_is(0, AUDIO_BLOCK, SILENCE));
+}
+
+static void test_overflow(void)
+{
+	fill(samples[0], 1);
+
+	int queued = 0;
+
+	while (audio_play(samples[0], AUDIO_BLOCK, 256))
+		queued++;
+
+	CHECK(16 == queued);
+
+	/* Mixing drains the queue into the voices. */
+	audio_mix(out, AUDIO_BLOCK);
+	CHECK(block_is(0, AUDIO_BLOCK, SILENCE + AUDIO_CHANNELS));
+
+	CHECK(audio_play(samples[0], AUDIO_BLOCK, 256));
+
+	drain();
+}
+
+int main(void)
+{
+	test_clipping();
+	test_stealing();
+	test_end_mid_block();
+	test_overflow();
+
+	return test_failures > 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <stdio.h>
+
+#include <dap.h>
+#include <dap_fuzz.h>
+#include <link.h>
+
+#include "swd_target.h"
+#include "test.h"
+
+#define SWDIO_PIN 25
+#define SWCLK_PIN 24
+
+#define TARGET 0x01002927
+
+static struct swd_target target;
+
+static void connect(void)
+{
+	swd_target_detach_all();
+	swd_target_attach(&target, SWCLK_PIN, SWDIO_PIN, TARGET);
+
+	dap_init(SWDIO_PIN, SWCLK_PIN);
+	CHECK(link_init(TARGET, NULL));
+}
+
+/*
+ * Run the conformance fuzzer with every kind of fault injected at given
+ * odds. Every injected WAIT must be retried and nothing else may be.
+ */
+static void test_fuzz(unsigned odds, unsigned rounds)
+{
+	struct dap_faults faults = { odds, odds, odds, odds };
+	struct dap_fuzz_report report;
+
+	connect();
+
+	dap_injected_reset(&faults);
+	dap_retries_reset();
+
+	faults = (struct dap_faults){ odds, odds, odds, odds };
+	CHECK(dap_inject(&faults));
+
+	bool ok = dap_fuzz(odds + 1, rounds, &report);
+
+	struct dap_faults injected;
+	dap_injected_reset(&injected);
+	unsigned retries = dap_retries_reset();
+
+	dap_inject(&(struct dap_faults){ 0 });
+
+	printf("fuzz at %u/65536: %u ops, %u failed, injected %u waits, %u faults, "
+	       "%u parity, %u noise, %u retries\n",
+	       odds, report.ops, report.failed, injected.wait, injected.fault, injected.parity,
+	       injected.noise, retries);
+
+	CHECK(ok);
+	CHECK(0 == report.mismatches);
+	CHECK(0 == report.overruns);
+	CHECK(0 == report.silent);
+	CHECK(retries == injected.wait);
+	CHECK(0 == target.waits);
+	CHECK(0 == target.contention);
+
+	if (odds) {
+		CHECK(injected.wait > 0);
+		CHECK(report.failed > 0);
+	} else {
+		CHECK(0 == report.failed);
+	}
+}
+
+/*
+ * Clock cycles per bit, as long as dap.c is built with its default
+ * pin toggle overhead and delay loop cost.
+ */
+static uint64_t bit_cycles(int delay)
+{
+	return 2 * (4 + 3 * (uint64_t)delay);
+}
+
+static void test_clock(void)
+{
+	static const uint32_t sys[] = { 12000000, 48000000, 125000000, 133000000, 200000000 };
+	static const uint32_t swd[] = { 1, 100000, 1000000, 4000000, 7812500, 12000000, 50000000 };
+
+	for (unsigned i = 0; i < sizeof(sys) / sizeof(*sys); i++) {
+		for (unsigned j = 0; j < sizeof(swd) / sizeof(*swd); j++) {
+			int delay = dap_delay_for(sys[i], swd[j]);
+
+			CHECK(delay >= 0);
+			CHECK(dap_set_clock(sys[i], swd[j]) == sys[i] / bit_cycles(delay));
+
+			/* Never faster than requested, but no slower than needed. */
+			CHECK(bit_cycles(delay) * swd[j] >= sys[i]);
+
+			if (delay > 0)
+				CHECK(bit_cycles(delay - 1) * swd[j] < sys[i]);
+		}
+	}
+
+	CHECK(20 == dap_delay_for(125000000, 1000000));
+	CHECK(0 == dap_delay_for(125000000, 50000000));
+
+	/* Used to divide by zero. */
+	CHECK(dap_delay_for(125000000, 0) > 0);
+	CHECK(dap_set_clock(125000000, 0) > 0);
+}
+
+int main(void)
+{
+	test_fuzz(0, 500);
+	test_fuzz(16, 2000);
+	test_fuzz(128, 2000);
+	test_fuzz(1024, 1000);
+	test_clock();
+
+	return test_failures > 0;
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <stdio.h>
+
+#include <dap_multi.h>
+
+#include "swd_target.h"
+#include "test.h"
+
+#define SWCLK_PIN 10
+#define SWDIO_PIN 11
+
+#define TARGET 0x01002927
+
+/*
+ * Links 0 to 3 have a target, the one on link 3 is not the selected one.
+ * Nothing is connected to link 4.
+ */
+#define NUM_LINKS 5
+#define NUM_TARGETS 4
+
+#define GOOD_LINKS 0x07
+
+static struct swd_target targets[NUM_TARGETS];
+static uint32_t all_links;
+
+static void connect(void)
+{
+	int pins[NUM_LINKS];
+
+	swd_target_detach_all();
+
+	for (int i = 0; i < NUM_TARGETS; i++)
+		swd_target_attach(&targets[i], SWCLK_PIN, SWDIO_PIN + i, 3 == i ? TARGET + 1 : TARGET);
+
+	for (int i = 0; i < NUM_LINKS; i++)
+		pins[i] = SWDIO_PIN + i;
+
+	all_links = dap_multi_init(SWCLK_PIN, pins, NUM_LINKS);
+	CHECK(0x1f == all_links);
+
+	dap_multi_reset();
+	dap_multi_select_target(TARGET);
+
+	uint32_t idcodes[NUM_LINKS];
+	CHECK(GOOD_LINKS == dap_multi_read_idcode(all_links, idcodes));
+
+	for (int i = 0; i < NUM_LINKS; i++)
+		if (GOOD_LINKS & (1u << i))
+			CHECK(SWD_TARGET_DPIDR == idcodes[i]);
+
+	CHECK(GOOD_LINKS == dap_multi_setup_mem(all_links));
+}
+
+static uint32_t target_peek(int link, uint32_t addr)
+{
+	return targets[link].mem[(addr - SWD_TARGET_BASE) / 4];
+}
+
+/*
+ * Check that targets on given links hold the value.
+ */
+static bool targets_hold(uint32_t links, uint32_t addr, uint32_t value)
+{
+	for (int i = 0; i < NUM_TARGETS; i++)
+		if ((links & (1u << i)) && target_peek(i, addr) != value)
+			return false;
+
+	return true;
+}
+
+static void check_no_contention(void)
+{
+	for (int i = 0; i < NUM_TARGETS; i++)
+		CHECK(0 == targets[i].contention);
+}
+
+static void test_lock_step(void)
+{
+	uint32_t values[NUM_LINKS];
+
+	connect();
+
+	CHECK(GOOD_LINKS == dap_multi_poke(SWD_TARGET_BASE, 0x12345678, all_links));
+	CHECK(targets_hold(GOOD_LINKS, SWD_TARGET_BASE, 0x12345678));
+
+	CHECK(GOOD_LINKS == dap_multi_peek(SWD_TARGET_BASE, values, all_links));
+
+	for (int i = 0; i < NUM_LINKS; i++)
+		if (GOOD_LINKS & (1u << i))
+			CHECK(0x12345678 == values[i]);
+
+	/* Block crossing a 1 KiB boundary. */
+	uint32_t block[300];
+
+	for (int i = 0; i < 300; i++)
+		block[i] = 0xb10c0000 + i;
+
+	CHECK(GOOD_LINKS == dap_multi_poke_many(SWD_TARGET_BASE + 0x300, block, 300, all_links));
+
+	for (int i = 0; i < 300; i++)
+		CHECK(targets_hold(GOOD_LINKS, SWD_TARGET_BASE + 0x300 + 4 * i, block[i]));
+
+	/* Read it back, with the first word past the boundary differing. */
+	static uint32_t readback[NUM_LINKS][300];
+
+	for (int l = 0; l < NUM_TARGETS; l++)
+		targets[l].mem[0x400 / 4] = 0xd1ff0000 + l;
+
+	CHECK(GOOD_LINKS ==
+	      dap_multi_peek_many(SWD_TARGET_BASE + 0x300, readback[0], 300, all_links));
+
+	for (int l = 0; l < NUM_LINKS; l++) {
+		for (int i = 0; i < 300; i++) {
+			if (!(GOOD_LINKS & (1u << l)))
+				CHECK(0 == readback[l][i]);
+			else if (64 == i)
+				CHECK(0xd1ff0000 + l == readback[l][i]);
+			else
+				CHECK(block[i] == readback[l][i]);
+		}
+	}
+
+	check_no_contention();
+}
+
+static void test_wait(void)
+{
+	uint32_t values[NUM_LINKS];
+
+	connect();
+
+	for (int i = 0; i < NUM_TARGETS; i++)
+		targets[i].oks = 0;
+
+	/* Only links that asked to wait get the request again. */
+	targets[1].wait = 3;
+	targets[2].wait = 5;
+
+	CHECK(GOOD_LINKS == dap_multi_poke(SWD_TARGET_BASE + 4, 0xcafe, all_links));
+	CHECK(targets_hold(GOOD_LINKS, SWD_TARGET_BASE + 4, 0xcafe));
+
+	for (int i = 0; i < 3; i++)
+		CHECK(2 == targets[i].oks);
+
+	CHECK(0 == targets[0].waits);
+	CHECK(3 == targets[1].waits);
+	CHECK(5 == targets[2].waits);
+
+	/* Reads retry the same way. */
+	CHECK(GOOD_LINKS == dap_multi_set_reg(DAP_AP4, SWD_TARGET_BASE + 4, all_links));
+
+	targets[0].wait = 1;
+	targets[2].wait = 2;
+
+	CHECK(GOOD_LINKS == dap_multi_get_reg(DAP_APc, values, all_links));
+
+	targets[1].wait = 2;
+
+	CHECK(GOOD_LINKS == dap_multi_get_reg(DAP_DPc, values, all_links));
+
+	for (int i = 0; i < 3; i++)
+		CHECK(0xcafe == values[i]);
+
+	/* A link that keeps waiting drops out, the rest carry on. */
+	targets[1].wait = 1000;
+
+	CHECK((GOOD_LINKS & ~0x02u) == dap_multi_poke(SWD_TARGET_BASE + 8, 0xbeef, all_links));
+	CHECK(targets_hold(GOOD_LINKS & ~0x02u, SWD_TARGET_BASE + 8, 0xbeef));
+	CHECK(0 == target_peek(1, SWD_TARGET_BASE + 8));
+
+	/* It is still in sync once it stops waiting. */
+	targets[1].wait = 0;
+
+	CHECK(0x02 == dap_multi_poke(SWD_TARGET_BASE + 8, 0xbeef, 0x02));
+	CHECK(targets_hold(GOOD_LINKS, SWD_TARGET_BASE + 8, 0xbeef));
+
+	check_no_contention();
+}
+
+static void test_fault(void)
+{
+	uint32_t values[NUM_LINKS];
+	uint32_t block[16];
+
+	connect();
+
+	for (int i = 0; i < 16; i++)
+		block[i] = 0xf0000000 + i;
+
+	/* Faulting link drops out of a write. */
+	targets[1].sticky = SWD_STICKYERR;
+
+	CHECK((GOOD_LINKS & ~0x02u) == dap_multi_poke_many(SWD_TARGET_BASE, block, 16, all_links));
+
+	for (int i = 0; i < 16; i++) {
+		CHECK(targets_hold(GOOD_LINKS & ~0x02u, SWD_TARGET_BASE + 4 * i, block[i]));
+		CHECK(0 == target_peek(1, SWD_TARGET_BASE + 4 * i));
+	}
+
+	/* And out of a read, while the others read their data. */
+	targets[1].sticky = 0;
+
+	CHECK(GOOD_LINKS == dap_multi_set_reg(DAP_AP4, SWD_TARGET_BASE + 4, all_links));
+
+	targets[1].sticky = SWD_STICKYERR;
+
+	CHECK((GOOD_LINKS & ~0x02u) == dap_multi_get_reg(DAP_APc, values, all_links));
+	CHECK((GOOD_LINKS & ~0x02u) == dap_multi_get_reg(DAP_DPc, values, all_links));
+	CHECK(0xf0000001 == values[0]);
+	CHECK(0xf0000001 == values[2]);
+
+	/* ABORT brings it back. */
+	CHECK(0x02 == dap_multi_set_reg(DAP_DP0, 0x1e, 0x02));
+	CHECK(0 == targets[1].sticky);
+
+	CHECK(0x02 == dap_multi_poke_many(SWD_TARGET_BASE, block, 16, 0x02));
+	CHECK(GOOD_LINKS == dap_multi_peek(SWD_TARGET_BASE + 60, values, GOOD_LINKS));
+
+	for (int i = 0; i < 3; i++)
+		CHECK(0xf000000f == values[i]);
+
+	check_no_contention();
+}
+
+/*
+ * Links without a target or with another one selected never ACK.
+ * They must be turned around without disturbing the rest.
+ */
+static void test_silent(void)
+{
+	uint32_t values[NUM_LINKS];
+
+	connect();
+
+	for (int i = 0; i < 20; i++) {
+		uint32_t addr = SWD_TARGET_BASE + 4 * i;
+
+		CHECK(0 == dap_multi_poke(addr, i, 0x18));
+		CHECK(0 == dap_multi_peek(addr, values, 0x18));
+
+		CHECK(GOOD_LINKS == dap_multi_poke(addr, 0x5000 + i, all_links));
+		CHECK(GOOD_LINKS == dap_multi_peek(addr, values, all_links));
+
+		for (int l = 0; l < 3; l++)
+			CHECK(0x5000u + i == values[l]);
+	}
+
+	CHECK(0 == targets[3].oks);
+	CHECK(0 == target_peek(3, SWD_TARGET_BASE));
+
+	check_no_contention();
+}
+
+int main(void)
+{
+	test_lock_step();
+	test_wait();
+	test_fault();
+	test_silent();
+
+	return test_failures > 0;
+}
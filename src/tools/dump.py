@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+
+"""
+Dump target memory through the master's USB serial console.
+
+Sends the dump command, collects compressed frames, verifies their
+checksums and writes the reassembled memory into a file.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+import serial
+
+
+def decompress(payload):
+    out = bytearray()
+    i = 0
+
+    while i < len(payload):
+        c = payload[i]
+        i += 1
+
+        if c < 0x80:
+            n = 4 * (c + 1)
+            out += payload[i:i + n]
+            i += n
+        else:
+            out += payload[i:i + 4] * (c - 0x7f)
+            i += 4
+
+    return bytes(out)
+
+
+def read_exact(port, n):
+    data = port.read(n)
+    if len(data) < n:
+        raise TimeoutError('device stopped responding')
+    return data
+
+
+def sync(port):
+    """Skip everything up to the next frame magic, e.g. log lines."""
+    window = b''
+
+    while window != b'DUMP':
+        window = (window + read_exact(port, 1))[-4:]
+
+
+def receive(port, start, length):
+    image = bytearray(length)
+    expect = start
+
+    while True:
+        sync(port)
+
+        header = read_exact(port, 8)
+        addr, words, size = struct.unpack('<IHH', header)
+        payload = read_exact(port, size)
+        crc, = struct.unpack('<I', read_exact(port, 4))
+
+        if zlib.crc32(header + payload) != crc:
+            raise ValueError(f'checksum mismatch in frame at {addr:#010x}')
+
+        if not words:
+            return image, addr
+
+        if addr != expect:
+            raise ValueError(f'expected frame at {expect:#010x}, got {addr:#010x}')
+
+        data = decompress(payload)
+
+        if len(data) != 4 * words:
+            raise ValueError(f'frame at {addr:#010x} decompressed to {len(data)} bytes')
+
+        image[addr - start:addr - start + len(data)] = data
+        expect += len(data)
+
+        print(f'\r{expect - start}/{length} bytes', end='', file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+    parser.add_argument('-p', '--port', default='/dev/ttyACM0')
+    parser.add_argument('addr', type=lambda x: int(x, 0))
+    parser.add_argument('length', type=lambda x: int(x, 0))
+    parser.add_argument('output')
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, timeout=5) as port:
+        port.reset_input_buffer()
+        port.write(f'dump {args.addr:#x} {args.length:#x}\r'.encode())
+
+        image, missing = receive(port, args.addr, args.length & ~3)
+
+    print(file=sys.stderr)
+
+    if missing:
+        print(f'dump: {missing} words could not be read', file=sys.stderr)
+
+    with open(args.output, 'wb') as fp:
+        fp.write(image[:len(image) - 4 * missing])
+
+    return 1 if missing else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
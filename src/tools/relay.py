@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+
+
+"""
+Relay input between two consoles playing against each other.
+
+Starts a session on both masters, forwards their input lines to the
+other side and prints everything else they say. Optional latency helps
+to exercise the rollback on a single desk.
+"""
+
+import argparse
+import queue
+import sys
+import threading
+import time
+
+import serial
+
+
+def receive(name, src, pending, latency):
+    while True:
+        line = src.readline()
+
+        if not line:
+            continue
+
+        if line.startswith((b'input ', b'sync ')):
+            pending.put((time.monotonic() + latency, line.rstrip() + b'\r'))
+            continue
+
+        print(f'{name}: {line.decode(errors="replace").rstrip()}', file=sys.stderr)
+
+
+def deliver(pending, dst):
+    while True:
+        deadline, line = pending.get()
+        delay = deadline - time.monotonic()
+
+        # Lines are queued in order with a constant latency.
+        if delay > 0:
+            time.sleep(delay)
+
+        dst.write(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+    parser.add_argument('-l', '--latency', type=float, default=0,
+                        help='one-way delay in milliseconds')
+    parser.add_argument('port1', help='console playing as the left hamster')
+    parser.add_argument('port2', help='console playing as the right hamster')
+    args = parser.parse_args()
+
+    one = serial.Serial(args.port1, timeout=1)
+    two = serial.Serial(args.port2, timeout=1)
+
+    for port in (one, two):
+        port.reset_input_buffer()
+
+    # Sides synchronise, so the order does not matter.
+    one.write(b'net 1\r')
+    two.write(b'net 2\r')
+
+    latency = args.latency / 1000
+    threads = []
+
+    for name, src, dst in (('1', one, two), ('2', two, one)):
+        pending = queue.Queue()
+        threads.append(threading.Thread(target=receive, args=(name, src, pending, latency)))
+        threads.append(threading.Thread(target=deliver, args=(pending, dst)))
+
+    for thread in threads:
+        thread.daemon = True
+        thread.start()
+
+    try:
+        while all(thread.is_alive() for thread in threads):
+            time.sleep(0.5)
+    except KeyboardInterrupt:
+        pass
+
+    for port in (one, two):
+        port.write(b'net off\r')
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
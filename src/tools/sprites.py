@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+#
+# Permission to use, copy, modify, and/or distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+# WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+# ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+# WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+# ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+# OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""
+Convert PBM/PGM images to packed sprite data.
+
+PBM images become monochrome sprites drawn in a color chosen at runtime.
+PGM images carry palette indices directly, 0 being transparent.
+
+Every sprite is cropped to the bounding box of its visible pixels and
+stored either as a packed bitmap or as per-row runs, whichever is smaller
+(monochrome only, indexed sprites always use runs).
+"""
+
+import argparse
+import os
+import re
+import sys
+
+
+def read_pnm(path):
+    with open(path, 'rb') as fp:
+        data = fp.read()
+
+    magic = data[:2]
+    pos = 2
+    fields = []
+    count = 3 if magic in (b'P1', b'P4') else 4
+
+    while len(fields) < count - 1:
+        m = re.compile(rb'(\s|#[^\n]*\n)*(\d+)').match(data, pos)
+        if not m:
+            raise ValueError(f'{path}: malformed header')
+        fields.append(int(m.group(2)))
+        pos = m.end()
+
+    width, height = fields[0], fields[1]
+    maxval = fields[2] if count == 4 else 1
+
+    if magic == b'P1':
+        bits = re.findall(rb'[01]', re.sub(rb'#[^\n]*\n', b'', data[pos:]))
+        pixels = [int(b) for b in bits]
+    elif magic == b'P4':
+        stride = (width + 7) // 8
+        raw = data[pos + 1:]
+        pixels = []
+        for y in range(height):
+            row = raw[y * stride:(y + 1) * stride]
+            pixels += [(row[x // 8] >> (7 - x % 8)) & 1 for x in range(width)]
+    elif magic == b'P2':
+        body = re.sub(rb'#[^\n]*\n', b'', data[pos:])
+        pixels = [int(v) for v in body.split()]
+    elif magic == b'P5':
+        if maxval > 255:
+            raise ValueError(f'{path}: 16-bit PGM is not supported')
+        pixels = list(data[pos + 1:pos + 1 + width * height])
+    else:
+        raise ValueError(f'{path}: not a PBM or PGM image')
+
+    if len(pixels) < width * height:
+        raise ValueError(f'{path}: truncated image')
+
+    rows = [pixels[y * width:(y + 1) * width] for y in range(height)]
+    return rows, magic in (b'P2', b'P5')
+
+
+def crop(rows):
+    ys = [y for y, row in enumerate(rows) if any(row)]
+    if not ys:
+        return 0, 0, []
+
+    xs = [x for row in rows for x, v in enumerate(row) if v]
+    x0, x1 = min(xs), max(xs) + 1
+    y0, y1 = min(ys), max(ys) + 1
+
+    return x0, y0, [row[x0:x1] for row in rows[y0:y1]]
+
+
+def encode_runs(rows, indexed):
+    out = []
+
+    for row in rows:
+        runs = []
+        x = 0
+
+        while x < len(row):
+            if not row[x]:
+                x += 1
+                continue
+
+            start = x
+            while x < len(row) and row[x] == row[start] and x - start < 255:
+                x += 1
+
+            runs.append((start, x - start, row[start]))
+
+        out.append(len(runs))
+
+        for start, length, color in runs:
+            out += [start, length]
+            if indexed:
+                out.append(color)
+
+    return out
+
+
+def encode_bitmap(rows):
+    out = []
+
+    for row in rows:
+        for i in range(0, len(row), 8):
+            byte = 0
+            for bit, v in enumerate(row[i:i + 8]):
+                byte |= (1 if v else 0) << (7 - bit)
+            out.append(byte)
+
+    return out
+
+
+def convert(path, mode):
+    rows, indexed = read_pnm(path)
+    x, y, rows = crop(rows)
+    w = len(rows[0]) if rows else 0
+    h = len(rows)
+
+    if w > 255 or h > 255:
+        raise ValueError(f'{path}: sprite is too large')
+
+    runs = encode_runs(rows, indexed)
+
+    if indexed or mode == 'always':
+        return x, y, w, h, indexed, True, runs
+
+    bitmap = encode_bitmap(rows)
+
+    if mode == 'never' or len(bitmap) <= len(runs):
+        return x, y, w, h, indexed, False, bitmap
+
+    return x, y, w, h, indexed, True, runs
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+    parser.add_argument('-o', '--output', required=True,
+                        help='output path without the .c/.h suffix')
+    parser.add_argument('--rle', choices=('auto', 'always', 'never'), default='auto',
+                        help='when to store sprites as runs')
+    parser.add_argument('images', nargs='+')
+    args = parser.parse_args()
+
+    header = os.path.basename(args.output) + '.h'
+    decls = []
+    defs = []
+
+    for path in sorted(args.images):
+        name = re.sub(r'\W', '_', os.path.splitext(os.path.basename(path))[0])
+
+        try:
+            x, y, w, h, indexed, rle, data = convert(path, args.rle)
+        except ValueError as exc:
+            print(f'sprites: {exc}', file=sys.stderr)
+            return 1
+
+        decls.append(f'extern const struct sprite sprite_{name};\n')
+
+        body = ''.join(f'0x{b:02x},{" " if (i + 1) % 12 else chr(10) + chr(9)}'
+                       for i, b in enumerate(data)).rstrip()
+
+        flags = ' | '.join(f for f, on in (('SPRITE_RLE', rle), ('SPRITE_INDEXED', indexed))
+                           if on) or '0'
+
+        defs.append(f'static const uint8_t sprite_{name}_data[] = {{\n\t{body}\n}};\n\n'
+                    f'const struct sprite sprite_{name} = {{\n'
+                    f'\t.x = {x},\n\t.y = {y},\n\t.w = {w},\n\t.h = {h},\n'
+                    f'\t.flags = {flags},\n'
+                    f'\t.data = sprite_{name}_data,\n}};\n')
+
+    banner = '/* Generated by tools/sprites.py, do not edit. */\n\n'
+
+    with open(args.output + '.h', 'w') as fp:
+        fp.write(banner + '#pragma once\n#include <sprite.h>\n\n' + ''.join(decls))
+
+    with open(args.output + '.c', 'w') as fp:
+        fp.write(banner + f'#include "{header}"\n\n' + '\n'.join(defs))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
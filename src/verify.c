@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) Jan Hamal Dvořák <mordae@anilinux.org>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <pico/stdlib.h>
+
+#include <stdio.h>
+
+#include <dap.h>
+
+#include "crc32.h"
+#include "verify.h"
+
+/*
+ * Slave DMA channel to use.
+ */
+#if !defined(VERIFY_CHANNEL)
+#define VERIFY_CHANNEL 11
+#endif
+
+/*
+ * Word of slave SRAM the data is written into. Defaults to the end
+ * of SRAM4, which dap_fuzz uses as scratch as well.
+ */
+#if !defined(VERIFY_SINK)
+#define VERIFY_SINK 0x20040ffcu
+#endif
+
+/*
+ * Give up waiting for the DMA after this long. Reading 2 MiB of flash
+ * through XIP with a cold cache takes well under a second.
+ */
+#if !defined(VERIFY_TIMEOUT_US)
+#define VERIFY_TIMEOUT_US (5 * 1000 * 1000)
+#endif
+
+#define RESETS_CLR 0x4000f000u
+#define RESETS_DONE 0x4000c008u
+#define RESETS_DMA (1u << 2)
+
+#define DMA_CH(n) (0x50000000u + 0x40 * (n))
+#define DMA_READ_ADDR 0x00
+#define DMA_WRITE_ADDR 0x04
+#define DMA_TRANS_COUNT 0x08
+#define DMA_CTRL_TRIG 0x0c
+
+#define DMA_SNIFF_CTRL 0x50000434u
+#define DMA_SNIFF_DATA 0x50000438u
+#define DMA_CHAN_ABORT 0x50000444u
+
+#define CTRL_EN (1u << 0)
+#define CTRL_DATA_SIZE_WORD (2u << 2)
+#define CTRL_INCR_READ (1u << 4)
+#define CTRL_CHAIN_TO(n) ((uint32_t)(n) << 11)
+#define CTRL_TREQ_PERMANENT (0x3fu << 15)
+#define CTRL_IRQ_QUIET (1u << 21)
+#define CTRL_SNIFF_EN (1u << 23)
+#define CTRL_BUSY (1u << 24)
+#define CTRL_ERROR (1u << 31)
+
+/* CRC-32 over bit-reversed data, reversed and inverted, like zlib. */
+#define SNIFF_EN (1u << 0)
+#define SNIFF_DMACH(n) ((uint32_t)(n) << 1)
+#define SNIFF_CALC_CRC32R (1u << 5)
+#define SNIFF_OUT_REV (1u << 10)
+#define SNIFF_OUT_INV (1u << 11)
+
+static bool verify_setup(void)
+{
+	uint32_t done;
+
+	if (!dap_poke(RESETS_CLR, RESETS_DMA))
+		return false;
+
+	for (int i = 0; i < 32; i++) {
+		if (!dap_peek(RESETS_DONE, &done))
+			return false;
+
+		if (done & RESETS_DMA)
+			return true;
+	}
+
+	puts("verify: dma stuck in reset");
+	return false;
+}
+
+/*
+ * Stop the channel and release the sniffer. Best effort, the link
+ * might be what failed in the first place.
+ */
+static void verify_abort(void)
+{
+	uint32_t busy;
+
+	if (!dap_poke(DMA_CHAN_ABORT, 1u << VERIFY_CHANNEL))
+		return;
+
+	for (int i = 0; i < 32; i++) {
+		if (!dap_peek(DMA_CHAN_ABORT, &busy))
+			return;
+
+		if (!(busy & (1u << VERIFY_CHANNEL)))
+			break;
+	}
+
+	dap_poke(DMA_SNIFF_CTRL, 0);
+}
+
+bool verify_crc32(uint32_t addr, uint32_t len, uint32_t *crc)
+{
+	if ((addr | len) & 3) {
+		puts("verify: range not word aligned");
+		return false;
+	}
+
+	/* The slave might have been reset since the last time. */
+	if (!verify_setup())
+		return false;
+
+	if (!len) {
+		*crc = 0;
+		return true;
+	}
+
+	uint32_t sniff = SNIFF_EN | SNIFF_DMACH(VERIFY_CHANNEL) | SNIFF_CALC_CRC32R |
+			 SNIFF_OUT_REV | SNIFF_OUT_INV;
+
+	if (!dap_poke(DMA_SNIFF_CTRL, sniff))
+		return false;
+
+	if (!dap_poke(DMA_SNIFF_DATA, 0xffffffff))
+		return false;
+
+	uint32_t setup[4] = {
+		addr,
+		VERIFY_SINK,
+		len / 4,
+		CTRL_EN | CTRL_DATA_SIZE_WORD | CTRL_INCR_READ | CTRL_CHAIN_TO(VERIFY_CHANNEL) |
+			CTRL_TREQ_PERMANENT | CTRL_IRQ_QUIET | CTRL_SNIFF_EN,
+	};
+
+	/* The last word triggers the channel, it might run even on failure. */
+	if (!dap_poke_many(DMA_CH(VERIFY_CHANNEL), setup, 4))
+		goto fail;
+
+	uint32_t started = time_us_32();
+	uint32_t ctrl;
+
+	do {
+		if (!dap_peek(DMA_CH(VERIFY_CHANNEL) + DMA_CTRL_TRIG, &ctrl))
+			goto fail;
+
+		if (time_us_32() - started > VERIFY_TIMEOUT_US) {
+			puts("verify: dma timed out");
+			goto fail;
+		}
+	} while (ctrl & CTRL_BUSY);
+
+	if (ctrl & CTRL_ERROR) {
+		printf("verify: dma bus error in %#010x..%#010x\n", (unsigned)addr,
+		       (unsigned)(addr + len));
+		goto fail;
+	}
+
+	if (!dap_peek(DMA_SNIFF_DATA, crc))
+		goto fail;
+
+	return dap_poke(DMA_SNIFF_CTRL, 0);
+
+fail:
+	verify_abort();
+	return false;
+}
+
+bool verify_memory(uint32_t addr, const void *data, uint32_t len, bool *match)
+{
+	uint32_t remote;
+
+	if (!verify_crc32(addr, len, &remote))
+		return false;
+
+	*match = remote == crc32_update(0, data, len);
+	return true;
+}